@@ -1,7 +1,10 @@
 
 #include "app.h"
 
+#include "capture.h"
 #include "edit.h"
+#include "renderthread.h"
+#include "textureloader.h"
 
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wdeprecated-declarations"
@@ -47,6 +50,8 @@ App::App(AppSettings settings) {
     }
 
     Renderer::init();
+    // so the renderer knows how big a pixel is before the first resize
+    Renderer::resize(settings.width, settings.height);
 }
 
 App::~App() {}
@@ -103,22 +108,75 @@ void App::pushOverlay(Layer* layer) { layerstack.pushOverlay(layer); }
 
 Window& App::getWindow() { return *window; }
 
+bool App::can_use_render_thread() {
+    if (!settings.renderThread) return false;
+    for (Layer* layer : layerstack) {
+        if (!layer->splitsRender()) {
+            log_warn(
+                "Layer {} doesnt split onUpdate and onRender, running without "
+                "a render thread",
+                layer->name);
+            return false;
+        }
+    }
+    return true;
+}
+
 int App::run() {
+    // the render thread does the stats, swapping and captures when its on
+    const bool threaded = can_use_render_thread();
+    if (threaded) RenderThread::get().start(window.get());
+
     time.start();
     while (running) {
         prof give_me_a_name(__PROFILE_FUNC__);
         time.end();
-        Renderer::stats.reset();
-        Renderer::stats.begin();
+        if (!threaded) {
+            Renderer::stats.reset();
+            Renderer::stats.begin();
+        }
         if (isMinimized) continue;
         if (settings.clearEnabled)
             Renderer::clear(/* color */ {0.1f, 0.1f, 0.1f, 1.0f});
+        // loadAsync() textures the workers finished, up on the gl thread
+        Renderer::enqueue([] { TextureLoader::get().upload(); });
+        if (!threaded) TextureLoader::get().publish();
         for (Layer* layer : layerstack) {
             layer->onUpdate(time);
+            if (layer->splitsRender()) layer->onRender();
+        }
+
+        if (frameNumber == settings.captureFrame) {
+            FrameCapture::get().capture(settings.capturePath);
+            running = false;
         }
+        frameNumber++;
+        Renderer::endFrame();
+
+        if (threaded) {
+            Renderer::enqueue([] {
+                FrameCapture::get().endFrame(
+                    (int)Renderer::sceneData->viewportSize.x,
+                    (int)Renderer::sceneData->viewportSize.y);
+            });
+            RenderThread::get().wait();
+            TextureLoader::get().publish();
+            Renderer::publishStats();
+            RenderThread::get().submit();
+            window->pollEvents();
+            continue;
+        }
+
+        FrameCapture::get().endFrame((int)Renderer::sceneData->viewportSize.x,
+                                     (int)Renderer::sceneData->viewportSize.y);
         window->update();
         Renderer::stats.end();
+        Renderer::publishStats();
     }
+    // the last frame gets drawn before the context comes back to us
+    if (threaded) RenderThread::get().stop();
+    // dont leave with captures still in flight
+    FrameCapture::get().finish();
     return 0;
 }
 
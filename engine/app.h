@@ -29,6 +29,13 @@ struct AppSettings {
     bool escClosesWindow = false;
     // if not empty, init resources folder to this
     std::string initResourcesFolder = "";
+    // For golden image tests, saves frame number captureFrame to
+    // capturePath and then closes the app, see FrameCapture
+    int captureFrame = -1;
+    std::string capturePath = "";
+    // Submit and swap on a RenderThread so the next frame can update in
+    // the meantime, only if every layer splitsRender()
+    bool renderThread = false;
 };
 
 struct App {
@@ -39,6 +46,7 @@ struct App {
 
     bool running;
     LayerStack layerstack;
+    int frameNumber = 0;
 
     static void create(AppSettings settings);
     static App& get();
@@ -55,6 +63,9 @@ struct App {
     void pushOverlay(Layer* layer);
     Window& getWindow();
     int run();
+
+   private:
+    bool can_use_render_thread();
 };
 
 [[deprecated("You should use App::get()")]] static std::shared_ptr<App>
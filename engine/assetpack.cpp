@@ -0,0 +1,324 @@
+#include "assetpack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+#if !_WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool AssetPack::open(const std::string& resourceFolder) {
+    if (isOpen() && resourceFolder == folder) return true;
+    close();
+
+    const std::string path =
+        fmt::format("{}/{}", resourceFolder, AssetPack::FILENAME);
+    if (!std::__fs::filesystem::exists(path)) {
+        log_trace("No asset pack at {}, loading resources from disk", path);
+        return false;
+    }
+
+#if _WIN32
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    fallback.assign(std::istreambuf_iterator<char>(in),
+                    std::istreambuf_iterator<char>());
+    data = fallback.data();
+    size = fallback.size();
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        log_warn("Failed to open asset pack {}", path);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* mapped =
+            mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            data = (const char*)mapped;
+            size = (size_t)info.st_size;
+        }
+    }
+    // the mapping stays valid without the fd
+    ::close(fd);
+    if (!data) {
+        log_warn("Failed to map asset pack {}", path);
+        return false;
+    }
+#endif
+
+    if (!validate(path)) {
+        close();
+        return false;
+    }
+    folder = resourceFolder;
+    log_info("Loaded asset pack {} ({} files, {} bytes)", path,
+             header().numEntries, size);
+    return true;
+}
+
+void AssetPack::close() {
+    if (!data) return;
+#if !_WIN32
+    munmap((void*)data, size);
+#endif
+    fallback.clear();
+    fallback.shrink_to_fit();
+    data = nullptr;
+    size = 0;
+    folder.clear();
+}
+
+bool AssetPack::validate(const std::string& path) const {
+    if (size < sizeof(Header) ||
+        std::memcmp(header().magic, MAGIC, sizeof(MAGIC)) != 0) {
+        log_warn("Asset pack {} isnt an asset pack, ignoring it", path);
+        return false;
+    }
+    if (header().version != VERSION) {
+        log_warn("Asset pack {} is version {} but we read {}, rebuild it",
+                 path, header().version, VERSION);
+        return false;
+    }
+
+    const uint64_t namesStart =
+        sizeof(Header) + (uint64_t)header().numEntries * sizeof(Entry);
+    if (namesStart + header().numNamesBytes > size) {
+        log_warn("Asset pack {} is cut off, ignoring it", path);
+        return false;
+    }
+    for (uint32_t i = 0; i < header().numEntries; i++) {
+        const Entry& entry = entries()[i];
+        if ((uint64_t)entry.nameOffset + entry.nameLength >
+                header().numNamesBytes ||
+            entry.offset > size || entry.size > size - entry.offset) {
+            log_warn("Asset pack {} has a broken entry, ignoring it", path);
+            return false;
+        }
+    }
+    return true;
+}
+
+std::optional<std::string_view> AssetPack::find(std::string_view name) const {
+    if (!isOpen()) return {};
+
+    if (name.starts_with(folder) && name.size() > folder.size() &&
+        name[folder.size()] == '/') {
+        name.remove_prefix(folder.size() + 1);
+    }
+
+    const Entry* first = entries();
+    const Entry* last = first + header().numEntries;
+    const Entry* it =
+        std::lower_bound(first, last, name, [&](const Entry& e, auto n) {
+            return name_of(e) < n;
+        });
+    if (it == last || name_of(*it) != name) return {};
+    return std::string_view(data + it->offset, it->size);
+}
+
+bool AssetPack::build(const std::string& resourceFolder,
+                      const std::string& out,
+                      const std::vector<std::string>& skip) {
+    namespace fs = std::__fs::filesystem;
+    if (!fs::exists(resourceFolder)) {
+        log_warn("Cant build asset pack, {} doesnt exist", resourceFolder);
+        return false;
+    }
+
+    struct File {
+        std::string name;
+        fs::path path;
+    };
+    std::vector<File> files;
+    for (auto const& entry :
+         fs::recursive_directory_iterator{resourceFolder}) {
+        if (!entry.is_regular_file()) continue;
+        std::string name =
+            entry.path().lexically_relative(resourceFolder).generic_string();
+        if (name == AssetPack::FILENAME) continue;
+        bool skipped = std::any_of(
+            skip.begin(), skip.end(), [&](const std::string& s) {
+                return name == s || (s.ends_with('/') && name.starts_with(s));
+            });
+        if (skipped) continue;
+        files.push_back(File{name, entry.path()});
+    }
+    std::sort(files.begin(), files.end(),
+              [](const File& a, const File& b) { return a.name < b.name; });
+
+    std::string names;
+    for (const File& file : files) names += file.name;
+
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.numEntries = (uint32_t)files.size();
+    header.numNamesBytes = (uint32_t)names.size();
+
+    auto align = [](uint64_t offset) {
+        return (offset + BLOB_ALIGNMENT - 1) & ~(BLOB_ALIGNMENT - 1);
+    };
+
+    std::vector<Entry> entries;
+    uint64_t offset = align(sizeof(Header) + files.size() * sizeof(Entry) +
+                            names.size());
+    uint32_t nameOffset = 0;
+    for (const File& file : files) {
+        Entry entry;
+        entry.offset = offset;
+        entry.size = fs::file_size(file.path);
+        entry.nameOffset = nameOffset;
+        entry.nameLength = (uint32_t)file.name.size();
+        entries.push_back(entry);
+        nameOffset += entry.nameLength;
+        offset = align(offset + entry.size);
+    }
+
+    std::ofstream os(out, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!os.is_open()) {
+        log_warn("Cant build asset pack, failed to write {}", out);
+        return false;
+    }
+    os.write((const char*)&header, sizeof(header));
+    os.write((const char*)entries.data(), entries.size() * sizeof(Entry));
+    os.write(names.data(), names.size());
+
+    std::vector<char> buffer;
+    for (size_t i = 0; i < files.size(); i++) {
+        // pad up to where the blob starts
+        const uint64_t at = (uint64_t)os.tellp();
+        std::string padding(entries[i].offset - at, '\0');
+        os.write(padding.data(), padding.size());
+
+        std::ifstream in(files[i].path, std::ios::in | std::ios::binary);
+        buffer.resize(entries[i].size);
+        if (!in.read(buffer.data(), buffer.size())) {
+            log_warn("Cant build asset pack, failed to read {}",
+                     files[i].path.string());
+            return false;
+        }
+        os.write(buffer.data(), buffer.size());
+        log_trace("packed {} ({} bytes)", files[i].name, entries[i].size);
+    }
+    log_info("Wrote asset pack {} with {} files ({} bytes)", out, files.size(),
+             (uint64_t)os.tellp());
+    return (bool)os;
+}
+
+static void test_write_file(const std::__fs::filesystem::path& path,
+                            const std::string& contents) {
+    std::__fs::filesystem::create_directories(path.parent_path());
+    std::ofstream os(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    os << contents;
+}
+
+static std::string test_make_resources() {
+    const auto folder =
+        std::__fs::filesystem::temp_directory_path() / "test_asset_pack";
+    std::__fs::filesystem::remove_all(folder);
+    test_write_file(folder / "shaders/flat.glsl", "flat");
+    test_write_file(folder / "shaders/texture.glsl", "texture shader");
+    test_write_file(folder / "fonts/Karmina.otf", "font");
+    test_write_file(folder / "notes.txt", "skip me");
+    return folder.generic_string();
+}
+
+static void test_asset_pack_round_trip() {
+    const std::string folder = test_make_resources();
+    const std::string out = fmt::format("{}/{}", folder, AssetPack::FILENAME);
+    M_ASSERT(AssetPack::build(folder, out, {"notes.txt", "fonts/"}),
+             "building the pack should work");
+
+    AssetPack& pack = AssetPack::get();
+    pack.close();
+    M_ASSERT(pack.open(folder), "the pack we just built should open");
+    M_ASSERT(pack.numEntries() == 2, "skipped files shouldnt be packed");
+
+    auto flat = pack.find("shaders/flat.glsl");
+    M_ASSERT(flat && *flat == "flat", "should find a file by its name");
+    M_ASSERT((uintptr_t)flat->data() % AssetPack::BLOB_ALIGNMENT == 0,
+             "blobs should be aligned");
+    auto texture = pack.find(folder + "/shaders/texture.glsl");
+    M_ASSERT(texture && *texture == "texture shader",
+             "the resources folder prefix should be stripped");
+    M_ASSERT(!pack.find("notes.txt"), "skipped files shouldnt be found");
+    M_ASSERT(!pack.find("fonts/Karmina.otf"),
+             "skipped folders shouldnt be found");
+    M_ASSERT(!pack.find("shaders/missing.glsl"),
+             "missing files shouldnt be found");
+    M_ASSERT(!pack.find("shaders"), "folders arent files");
+
+    pack.close();
+    std::__fs::filesystem::remove_all(folder);
+}
+
+static void test_asset_pack_rejects_broken_table() {
+    const std::string folder = test_make_resources();
+    const std::string out = fmt::format("{}/{}", folder, AssetPack::FILENAME);
+    M_ASSERT(AssetPack::build(folder, out), "building the pack should work");
+
+    std::vector<char> bytes;
+    {
+        std::ifstream in(out, std::ios::in | std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in),
+                     std::istreambuf_iterator<char>());
+    }
+    auto write_pack = [&](const std::vector<char>& contents) {
+        std::ofstream os(out,
+                         std::ios::out | std::ios::binary | std::ios::trunc);
+        os.write(contents.data(), contents.size());
+    };
+
+    AssetPack& pack = AssetPack::get();
+    pack.close();
+
+    // the first blob runs past the end of the file
+    std::vector<char> broken = bytes;
+    AssetPack::Entry entry;
+    std::memcpy(&entry, broken.data() + sizeof(AssetPack::Header),
+                sizeof(entry));
+    entry.size = broken.size();
+    std::memcpy(broken.data() + sizeof(AssetPack::Header), &entry,
+                sizeof(entry));
+    write_pack(broken);
+    M_ASSERT(!pack.open(folder) && !pack.isOpen(),
+             "an entry past the end should be rejected");
+
+    // a name outside the names block
+    broken = bytes;
+    std::memcpy(&entry, broken.data() + sizeof(AssetPack::Header),
+                sizeof(entry));
+    entry.nameLength = 1 << 20;
+    std::memcpy(broken.data() + sizeof(AssetPack::Header), &entry,
+                sizeof(entry));
+    write_pack(broken);
+    M_ASSERT(!pack.open(folder), "a broken name should be rejected");
+
+    // cut off in the middle of the entry table
+    broken.assign(bytes.begin(),
+                  bytes.begin() + sizeof(AssetPack::Header) +
+                      sizeof(AssetPack::Entry));
+    write_pack(broken);
+    M_ASSERT(!pack.open(folder), "a cut off table should be rejected");
+
+    broken = bytes;
+    broken[0] = 'X';
+    write_pack(broken);
+    M_ASSERT(!pack.open(folder), "a bad magic should be rejected");
+
+    write_pack(bytes);
+    M_ASSERT(pack.open(folder), "the untouched pack should still open");
+
+    pack.close();
+    std::__fs::filesystem::remove_all(folder);
+}
+
+void test_asset_pack() {
+    test_asset_pack_round_trip();
+    test_asset_pack_rejects_broken_table();
+}
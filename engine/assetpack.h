@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "pch.hpp"
+
+// One file holding everything under the resources folder, so startup
+// doesnt open and read every shader and font on its own
+//
+// The pack is mmap'ed and find() hands back views straight into it, nothing
+// gets copied until the caller wants its own copy. The layout is
+//
+//      Header
+//      Entry[numEntries]   sorted by name, find() binary searches them
+//      names               numNamesBytes, not null terminated
+//      blobs               each starting on a BLOB_ALIGNMENT boundary
+//
+// Names are relative to the resources folder with forward slashes, like
+// "shaders/texture.glsl". Build one with AssetPack::build() (see
+// tools/packer), ResourceLocations::init() opens it if there is one
+struct AssetPack {
+    static constexpr char MAGIC[4] = {'G', 'P', 'A', 'K'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint64_t BLOB_ALIGNMENT = 16;
+    // what ResourceLocations looks for in its folder
+    static constexpr const char* FILENAME = "assets.pack";
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t numEntries;
+        uint32_t numNamesBytes;
+    };
+
+    struct Entry {
+        // from the start of the file
+        uint64_t offset;
+        uint64_t size;
+        // from the start of the names
+        uint32_t nameOffset;
+        uint32_t nameLength;
+    };
+
+    static_assert(sizeof(Header) == 16, "pack header is 16 bytes");
+    static_assert(sizeof(Entry) == 24, "pack entries are 24 bytes");
+
+    static AssetPack& get() {
+        static AssetPack pack;
+        return pack;
+    }
+
+    ~AssetPack() { close(); }
+
+    // Maps folder/assets.pack, does nothing if its already the open one.
+    // A missing pack isnt an error, everything just comes from disk
+    bool open(const std::string& folder);
+    void close();
+
+    bool isOpen() const { return data != nullptr; }
+    size_t numEntries() const { return isOpen() ? header().numEntries : 0; }
+
+    // The contents of name, which is either relative to the resources
+    // folder or starts with it ("./resources/shaders/flat.glsl" works too).
+    // The view is good until the pack is closed
+    std::optional<std::string_view> find(std::string_view name) const;
+
+    // Packs every file under resourceFolder into out, for tools/packer.
+    // skip are names (like find() takes them) to leave out, ones ending in
+    // a / leave out that whole folder
+    static bool build(const std::string& resourceFolder, const std::string& out,
+                      const std::vector<std::string>& skip = {});
+
+   private:
+    std::string folder;
+    const char* data = nullptr;
+    size_t size = 0;
+    // only used where there is no mmap
+    std::vector<char> fallback;
+
+    AssetPack() {}
+
+    const Header& header() const { return *(const Header*)data; }
+    const Entry* entries() const {
+        return (const Entry*)(data + sizeof(Header));
+    }
+    std::string_view name_of(const Entry& entry) const {
+        const char* names = (const char*)(entries() + header().numEntries);
+        return std::string_view(names + entry.nameOffset, entry.nameLength);
+    }
+
+    bool validate(const std::string& path) const;
+};
+
+void test_asset_pack();
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "log.h"
+
+// Skyline bin packer (bottom left heuristic)
+//
+// Keeps track of the top edge of everything placed so far as a list of
+// horizontal segments, each new rect goes wherever it ends up lowest.
+// Its not as tight as maxrects but its a lot simpler and plenty good for
+// sprites that are mostly the same size
+struct SkylinePacker {
+    struct Node {
+        int x;
+        int y;
+        int width;
+    };
+
+    int width;
+    int height;
+    std::vector<Node> skyline;
+    int usedArea = 0;
+
+    SkylinePacker(int w, int h) : width(w), height(h) {
+        skyline.push_back(Node{0, 0, w});
+    }
+
+    // false if it doesnt fit anywhere
+    bool insert(int w, int h, int& outX, int& outY) {
+        int bestIndex = -1;
+        int bestY = INT_MAX;
+        int bestWidth = INT_MAX;
+        for (size_t i = 0; i < skyline.size(); i++) {
+            int y;
+            if (!fits(i, w, h, y)) continue;
+            if (y < bestY || (y == bestY && skyline[i].width < bestWidth)) {
+                bestIndex = (int)i;
+                bestY = y;
+                bestWidth = skyline[i].width;
+            }
+        }
+        if (bestIndex == -1) return false;
+
+        outX = skyline[bestIndex].x;
+        outY = bestY;
+        add_level(bestIndex, outX, outY, w, h);
+        usedArea += w * h;
+        return true;
+    }
+
+    float occupancy() const {
+        return (float)usedArea / (float)(width * height);
+    }
+
+   private:
+    // y is set to how high the rect would sit if placed at skyline[index]
+    bool fits(size_t index, int w, int h, int& y) const {
+        int x = skyline[index].x;
+        if (x + w > width) return false;
+
+        int widthLeft = w;
+        y = skyline[index].y;
+        for (size_t i = index; widthLeft > 0; i++) {
+            if (i >= skyline.size()) return false;
+            y = std::max(y, skyline[i].y);
+            if (y + h > height) return false;
+            widthLeft -= skyline[i].width;
+        }
+        return true;
+    }
+
+    void add_level(size_t index, int x, int y, int w, int h) {
+        skyline.insert(skyline.begin() + index, Node{x, y + h, w});
+
+        // trim (or remove) the segments the new one now covers
+        for (size_t i = index + 1; i < skyline.size(); i++) {
+            const Node& prev = skyline[i - 1];
+            Node& node = skyline[i];
+            if (node.x >= prev.x + prev.width) break;
+
+            int shrink = prev.x + prev.width - node.x;
+            node.x += shrink;
+            node.width -= shrink;
+            if (node.width > 0) break;
+
+            skyline.erase(skyline.begin() + i);
+            i--;
+        }
+
+        // merge neighbors at the same height
+        for (size_t i = 0; i + 1 < skyline.size(); i++) {
+            if (skyline[i].y == skyline[i + 1].y) {
+                skyline[i].width += skyline[i + 1].width;
+                skyline.erase(skyline.begin() + i + 1);
+                i--;
+            }
+        }
+    }
+};
+
+// Copies an rgba image into the page at (x, y) and repeats its edge
+// pixels `pad` times around it, so linear filtering near the border of a
+// sprite samples itself instead of whatever was packed next to it
+inline void blit_with_padding(std::vector<uint8_t>& page, int pageWidth,
+                              int x, int y, const uint8_t* image, int w,
+                              int h, int pad) {
+    for (int row = -pad; row < h + pad; row++) {
+        int srcRow = std::clamp(row, 0, h - 1);
+        for (int col = -pad; col < w + pad; col++) {
+            int srcCol = std::clamp(col, 0, w - 1);
+            const uint8_t* src = image + (srcRow * w + srcCol) * 4;
+            uint8_t* dst =
+                page.data() + ((y + row) * pageWidth + (x + col)) * 4;
+            memcpy(dst, src, 4);
+        }
+    }
+}
+
+inline void test_skyline_places_bottom_left() {
+    SkylinePacker packer(64, 64);
+    int x = -1, y = -1;
+    M_ASSERT(packer.insert(16, 8, x, y) && x == 0 && y == 0,
+             "first rect should go in the corner");
+    M_ASSERT(packer.insert(16, 16, x, y) && x == 16 && y == 0,
+             "second rect should sit next to the first on the floor");
+    M_ASSERT(packer.insert(32, 8, x, y) && x == 32 && y == 0,
+             "the rest of the floor is still the lowest spot");
+    M_ASSERT(packer.insert(16, 8, x, y) && x == 0 && y == 8,
+             "the first column is the lowest now");
+}
+
+inline void test_skyline_fills_exactly() {
+    SkylinePacker packer(32, 32);
+    int x, y;
+    for (int i = 0; i < 4; i++) {
+        M_ASSERT(packer.insert(16, 16, x, y), "four quarters should fit");
+    }
+    M_ASSERT(!packer.insert(1, 1, x, y), "a full page shouldnt take more");
+    M_ASSERT(packer.occupancy() == 1.f, "a full page should be 100% used");
+    M_ASSERT(packer.skyline.size() == 1,
+             "segments at the same height should merge");
+}
+
+inline void test_skyline_rejects_too_big() {
+    SkylinePacker packer(32, 32);
+    int x, y;
+    M_ASSERT(!packer.insert(33, 1, x, y), "too wide shouldnt fit");
+    M_ASSERT(!packer.insert(1, 33, x, y), "too tall shouldnt fit");
+    M_ASSERT(packer.usedArea == 0, "failed inserts shouldnt use any area");
+}
+
+inline void test_skyline_no_overlap() {
+    struct Rect {
+        int x, y, w, h;
+    };
+    SkylinePacker packer(128, 128);
+    std::vector<Rect> placed;
+    for (int i = 0; i < 64; i++) {
+        Rect r{0, 0, 4 + (i * 7) % 21, 4 + (i * 13) % 17};
+        if (!packer.insert(r.w, r.h, r.x, r.y)) continue;
+        M_ASSERT(r.x >= 0 && r.y >= 0 && r.x + r.w <= 128 &&
+                     r.y + r.h <= 128,
+                 "rects should stay on the page");
+        for (const Rect& o : placed) {
+            bool apart = r.x + r.w <= o.x || o.x + o.w <= r.x ||
+                         r.y + r.h <= o.y || o.y + o.h <= r.y;
+            M_ASSERT(apart, "rects shouldnt overlap");
+        }
+        placed.push_back(r);
+    }
+    M_ASSERT(placed.size() > 32, "most of these should fit");
+}
+
+inline void test_blit_with_padding() {
+    // 2x1 image, red then green, into a 6x5 page with 1px of padding
+    const uint8_t image[] = {255, 0, 0, 255, 0, 255, 0, 255};
+    std::vector<uint8_t> page(6 * 5 * 4, 0);
+    blit_with_padding(page, 6, 1, 1, image, 2, 1, 1);
+
+    auto pixel = [&](int x, int y) { return page.data() + (y * 6 + x) * 4; };
+    M_ASSERT(pixel(1, 1)[0] == 255 && pixel(2, 1)[1] == 255,
+             "the image should be copied where it was placed");
+    M_ASSERT(pixel(0, 0)[0] == 255 && pixel(0, 2)[0] == 255,
+             "the corners should repeat the nearest edge pixel");
+    M_ASSERT(pixel(3, 1)[1] == 255 && pixel(3, 2)[1] == 255,
+             "the right edge should repeat green");
+    M_ASSERT(pixel(4, 1)[3] == 0, "nothing past the padding should change");
+}
+
+inline void test_atlas() {
+    test_skyline_places_bottom_left();
+    test_skyline_fills_exactly();
+    test_skyline_rejects_too_big();
+    test_skyline_no_overlap();
+    test_blit_with_padding();
+}
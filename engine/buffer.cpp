@@ -2,15 +2,40 @@
 
 #include "pch.hpp"
 
-VertexArray* VertexArray::create() { return new OpenGLVertexArray(); }
+VertexArray* VertexArray::create() {
+    if (RendererAPI::isNull()) return new NullVertexArray();
+    return new OpenGLVertexArray();
+}
 VertexBuffer* VertexBuffer::create(float* verts, int size) {
+    if (RendererAPI::isNull()) return new NullVertexBuffer(size);
     return new OpenGLVertexBuffer(verts, size);
 }
 
 VertexBuffer* VertexBuffer::create(int size) {
+    if (RendererAPI::isNull()) return new NullVertexBuffer(size);
     return new OpenGLVertexBuffer(size);
 }
 
+StreamingVertexBuffer* StreamingVertexBuffer::create(int batchSize,
+                                                     int batchesPerFrame) {
+    if (RendererAPI::isNull()) {
+        return new NullStreamingVertexBuffer(batchSize, batchesPerFrame);
+    }
+    return new OpenGLStreamingVertexBuffer(batchSize, batchesPerFrame);
+}
+
 IndexBuffer* IndexBuffer::create(unsigned int* i_s, unsigned int count) {
+    if (RendererAPI::isNull()) return new NullIndexBuffer(count);
     return new OpenGLIndexBuffer(i_s, count);
 }
+
+UniformBuffer* UniformBuffer::create(int size, unsigned int binding) {
+    if (RendererAPI::isNull()) return new NullUniformBuffer(size, binding);
+    return new OpenGLUniformBuffer(size, binding);
+}
+
+Framebuffer* Framebuffer::create(const std::string& name, int width,
+                                 int height) {
+    if (RendererAPI::isNull()) return new NullFramebuffer(name, width, height);
+    return new OpenGLFramebuffer(name, width, height);
+}
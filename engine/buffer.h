@@ -1,6 +1,9 @@
 #pragma once
 
 #include "pch.hpp"
+#include "glstate.h"
+#include "rendererapi.h"
+#include "texture.h"
 
 enum class BufferType {
     None = 0,
@@ -14,22 +17,43 @@ enum class BufferType {
     Int2,
     Int3,
     Int4,
-    Bool
+    Bool,
+    // smaller types for packed vertices, pass normalized = true to get
+    // them as 0 to 1 floats in the shader (see pack_unorm8x4)
+    UByte4,
+    UShort2,
 };
 
+// rgba in 0 to 1 -> 4 bytes, r ends up first in memory
+inline uint32_t pack_unorm8x4(const glm::vec4& v) {
+    auto to_byte = [](float f) {
+        return (uint32_t)(std::clamp(f, 0.f, 1.f) * 255.f + 0.5f);
+    };
+    return to_byte(v.r) | (to_byte(v.g) << 8) | (to_byte(v.b) << 16) |
+           (to_byte(v.a) << 24);
+}
+
+inline uint16_t pack_unorm16(float f) {
+    return (uint16_t)(std::clamp(f, 0.f, 1.f) * 65535.f + 0.5f);
+}
+
 struct BufferElem {
     std::string name;
     BufferType type;
     uintptr_t offset;
     int size;
     bool normalized;
+    // 0 means per vertex, 1 means advance once per instance
+    int divisor;
 
-    BufferElem(const std::string& n, BufferType t, bool norm = false)
+    BufferElem(const std::string& n, BufferType t, bool norm = false,
+               int div = 0)
         : name(n),
           type(t),
           offset(0),
           size(getDataTypeSize(t)),
-          normalized(norm) {}
+          normalized(norm),
+          divisor(div) {}
 
     inline GLenum typeToOpenGLType() const {
         switch (type) {
@@ -42,6 +66,10 @@ struct BufferElem {
             case BufferType::Mat3:
             case BufferType::Mat4:
                 return GL_FLOAT;
+            case BufferType::UByte4:
+                return GL_UNSIGNED_BYTE;
+            case BufferType::UShort2:
+                return GL_UNSIGNED_SHORT;
             default:
                 log_error("Missing type conversion for {}", (int)type);
                 return GL_FLOAT;
@@ -64,6 +92,9 @@ struct BufferElem {
                 return 4 * 4 * 4;
             case BufferType::Bool:
                 return 1;
+            case BufferType::UByte4:
+            case BufferType::UShort2:
+                return 4;
             default:
                 log_error("Missing buffer type size for {}", (int)t);
                 return -1;
@@ -76,10 +107,12 @@ struct BufferElem {
             case BufferType::Float:
                 return 1;
             case BufferType::Float2:
+            case BufferType::UShort2:
                 return 2;
             case BufferType::Float3:
                 return 3;
             case BufferType::Float4:
+            case BufferType::UByte4:
                 return 4;
             case BufferType::Mat3:
                 return 3;
@@ -128,10 +161,130 @@ struct VertexBuffer {
     virtual void unbind() const = 0;
     virtual void setLayout(const BufferLayout& l) = 0;
     virtual void setData(void* data, int size) = 0;
+    // only overwrites [offset, offset + size) in bytes
+    virtual void setSubData(void* data, int size, int offset) = 0;
     static VertexBuffer* create(float* verts, int size);
     static VertexBuffer* create(int size);
 };
 
+// Vertex buffer for data that gets rewritten every batch
+//
+// The buffer is split into NUM_FRAMES segments, one per frame in flight.
+// Every map() hands out the next batchSize bytes of the current segment,
+// so all the batches of a frame sit back to back in it, and endFrame()
+// puts one fence on the segment and moves to the next. We only wait on
+// that fence when we come back around to it NUM_FRAMES frames later,
+// which (unless the gpu is really far behind) has long since passed.
+//
+// A frame that doesnt fit in its segment moves on early (counted in
+// stats.overflows) and eats into the segments of the frames after it,
+// so give busy buffers more batchesPerFrame
+//
+// map() gives you a pointer you can write vertices straight into,
+// call unmap() with how much you wrote and draw with baseVertex()
+struct StreamingVertexBuffer : public VertexBuffer {
+    static const int NUM_FRAMES = 3;
+
+    struct Stats {
+        int maps = 0;
+        // how many times we had to wait for the gpu to finish a segment
+        int stalls = 0;
+        // seconds spent waiting
+        float stallTime = 0.f;
+        // frames that needed more than one segment
+        int overflows = 0;
+    };
+
+    // the most one map() can hold
+    int batchSize = 0;
+    // one frames worth of batches
+    int segmentSize = 0;
+    int segment = 0;
+    // bytes of the current segment that are already taken this frame
+    int used = 0;
+    // where the last map() starts, from the start of the whole buffer
+    int mapOffset = 0;
+    bool mapped = false;
+    Stats stats;
+
+    virtual ~StreamingVertexBuffer() {}
+
+    void* map() {
+        M_ASSERT(!mapped, "streaming buffer is already mapped");
+        if (used + batchSize > segmentSize) {
+            stats.overflows++;
+            next_segment();
+        }
+        mapOffset = (segment * segmentSize) + used;
+        stats.maps++;
+        mapped = true;
+        return map_range(mapOffset, batchSize);
+    }
+
+    void unmap(int size) {
+        if (!mapped) return;
+        mapped = false;
+        // the next batch starts on a whole vertex so baseVertex() lines up
+        const int stride = std::max(1, layout.stride);
+        used += ((size + stride - 1) / stride) * stride;
+        unmap_range(size);
+    }
+
+    // Call once every draw that read this frames batches has been
+    // submitted, nothing to do if the buffer wasnt used
+    void endFrame() {
+        M_ASSERT(!mapped, "end the batch before the frame");
+        if (used == 0) return;
+        next_segment();
+    }
+
+    // where the last map() starts, in vertices
+    int baseVertex() const { return mapOffset / layout.stride; }
+
+    // Same as map() + memcpy + unmap(), prefer writing into map() directly
+    virtual void setData(void* data, int size) override {
+        M_ASSERT(size <= batchSize, "data doesnt fit in a batch");
+        void* dest = map();
+        memcpy(dest, data, size);
+        unmap(size);
+    }
+
+    // batches are rewritten every map() so there is nothing to patch
+    virtual void setSubData(void*, int, int) override {
+        log_warn("setSubData does nothing on a StreamingVertexBuffer");
+    }
+
+    virtual void setLayout(const BufferLayout& l) override {
+        M_ASSERT(batchSize % l.stride == 0,
+                 "batch size has to be a multiple of the vertex size "
+                 "otherwise baseVertex() wont line up");
+        layout = l;
+    }
+
+    // batchSize bytes per map() and room for batchesPerFrame of them
+    // before a frame has to move on to the next segment
+    static StreamingVertexBuffer* create(int batchSize, int batchesPerFrame);
+
+   protected:
+    StreamingVertexBuffer(int size, int batchesPerFrame)
+        : batchSize(size), segmentSize(size * batchesPerFrame) {}
+
+    int totalSize() const { return segmentSize * NUM_FRAMES; }
+
+    void next_segment() {
+        fence_segment(segment);
+        segment = (segment + 1) % NUM_FRAMES;
+        used = 0;
+        wait_for_segment(segment);
+    }
+
+    virtual void* map_range(int offset, int size) = 0;
+    virtual void unmap_range(int size) = 0;
+    // the gpu is done with s once everything submitted so far is
+    virtual void fence_segment(int s) = 0;
+    virtual void wait_for_segment(int s) = 0;
+};
+
 struct IndexBuffer {
     unsigned int count;
 
@@ -139,80 +292,243 @@ struct IndexBuffer {
     virtual void bind() const = 0;
     virtual void unbind() const = 0;
     virtual unsigned int getCount() const { return count; }
+    // Replaces the first c indices, c cant be more than the count the
+    // buffer was created with
+    virtual void setData(const unsigned int* i_s, unsigned int c) = 0;
 
     static IndexBuffer* create(unsigned int* i_s, unsigned int count);
 };
 
+// Block of uniforms shared by every shader that declares it, bound to
+// a fixed binding point so uploading once covers all of them
+struct UniformBuffer {
+    int size;
+    unsigned int binding;
+
+    virtual ~UniformBuffer() {}
+    // offset and size in bytes
+    virtual void setData(const void* data, int size, int offset = 0) = 0;
+
+    static UniformBuffer* create(int size, unsigned int binding);
+};
+
 struct VertexArray {
     unsigned int rendererID;
     std::vector<std::shared_ptr<VertexBuffer>> vertexBuffers;
     std::shared_ptr<IndexBuffer> indexBuffer;
+    // attribute index the next added buffer starts at, so a second
+    // (per instance) buffer doesnt overwrite the first ones attributes
+    int nextAttribIndex = 0;
 
     virtual ~VertexArray() {}
     virtual void bind() const = 0;
     virtual void unbind() const = 0;
     virtual void addVertexBuffer(const std::shared_ptr<VertexBuffer>& vb) = 0;
     virtual void setIndexBuffer(const std::shared_ptr<IndexBuffer>& ib) = 0;
+    // Points the attributes of vertexBuffers[bufferIndex] byteOffset into
+    // the buffer, used to read instances out of a StreamingVertexBuffer
+    // batch without needing base instance (GL 4.2)
+    virtual void setBufferOffset(size_t bufferIndex, uintptr_t byteOffset) = 0;
     static VertexArray* create();
 };
 
+// Offscreen color target, everything drawn between bind() and unbind()
+// ends up in colorAttachment. Thats a normal Texture2D so it can go in the
+// TextureLibrary and be drawn with drawQuad like anything else
+struct Framebuffer {
+    unsigned int rendererID;
+    int width;
+    int height;
+    std::shared_ptr<Texture2D> colorAttachment;
+
+    virtual ~Framebuffer() {}
+    // also sets the viewport to cover the whole framebuffer
+    virtual void bind() = 0;
+    // back to the window and the viewport from before bind()
+    virtual void unbind() = 0;
+    // keeps the same colorAttachment (and handle) but its contents are gone
+    virtual void resize(int w, int h) = 0;
+
+    static Framebuffer* create(const std::string& name, int width,
+                               int height);
+};
+
 struct OpenGLVertexArray : public VertexArray {
+
+    std::vector<int> firstAttribIndex;
+
     OpenGLVertexArray() {
         glGenVertexArrays(1, &rendererID);
-        glBindVertexArray(rendererID);
+        gl_bind_vertex_array(rendererID);
     }
     virtual void addVertexBuffer(
         const std::shared_ptr<VertexBuffer>& vb) override {
         M_ASSERT(vb->layout.elements.size(), "Layout cannot be empty");
 
-        glBindVertexArray(rendererID);
+        gl_bind_vertex_array(rendererID);
         vb->bind();
 
-        int index = 0;
+        firstAttribIndex.push_back(nextAttribIndex);
         for (const auto& elem : vb->layout) {
-            glEnableVertexAttribArray(index);
-            glVertexAttribPointer(index, elem.getCount(),
+            glEnableVertexAttribArray(nextAttribIndex);
+            glVertexAttribPointer(nextAttribIndex, elem.getCount(),
                                   elem.typeToOpenGLType(),
                                   elem.normalized ? GL_TRUE : GL_FALSE,
                                   vb->layout.stride, (const void*)elem.offset);
-            index++;
+            if (elem.divisor) {
+                glVertexAttribDivisor(nextAttribIndex, elem.divisor);
+            }
+            nextAttribIndex++;
         }
         vertexBuffers.push_back(vb);
     }
 
+    virtual void setBufferOffset(size_t bufferIndex,
+                                 uintptr_t byteOffset) override {
+        const auto& vb = vertexBuffers[bufferIndex];
+        gl_bind_vertex_array(rendererID);
+        vb->bind();
+
+        int index = firstAttribIndex[bufferIndex];
+        for (const auto& elem : vb->layout) {
+            glVertexAttribPointer(index, elem.getCount(),
+                                  elem.typeToOpenGLType(),
+                                  elem.normalized ? GL_TRUE : GL_FALSE,
+                                  vb->layout.stride,
+                                  (const void*)(elem.offset + byteOffset));
+            index++;
+        }
+    }
+
     virtual void setIndexBuffer(
         const std::shared_ptr<IndexBuffer>& ib) override {
-        glBindVertexArray(rendererID);
+        gl_bind_vertex_array(rendererID);
         ib->bind();
         indexBuffer = ib;
     }
-    virtual ~OpenGLVertexArray() { glDeleteVertexArrays(1, &rendererID); }
-    virtual void bind() const override { glBindVertexArray(rendererID); }
-    virtual void unbind() const override { glBindVertexArray(0); }
+    virtual ~OpenGLVertexArray() {
+        GLState::get().forgetVertexArray(rendererID);
+        glDeleteVertexArrays(1, &rendererID);
+    }
+    virtual void bind() const override { gl_bind_vertex_array(rendererID); }
+    virtual void unbind() const override { gl_bind_vertex_array(0); }
 };
 
 struct OpenGLVertexBuffer : public VertexBuffer {
     unsigned int rendererID;
     OpenGLVertexBuffer(float* verts, unsigned int size) {
         glGenBuffers(1, &rendererID);
-        glBindBuffer(GL_ARRAY_BUFFER, rendererID);
+        gl_bind_array_buffer(rendererID);
         glBufferData(GL_ARRAY_BUFFER, size, verts, GL_STATIC_DRAW);
     }
     OpenGLVertexBuffer(unsigned int size) {
         glGenBuffers(1, &rendererID);
-        glBindBuffer(GL_ARRAY_BUFFER, rendererID);
+        gl_bind_array_buffer(rendererID);
         glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
     }
-    virtual ~OpenGLVertexBuffer() { glDeleteBuffers(1, &rendererID); }
+    virtual ~OpenGLVertexBuffer() {
+        GLState::get().forgetBuffer(rendererID);
+        glDeleteBuffers(1, &rendererID);
+    }
     virtual void bind() const override {
-        glBindBuffer(GL_ARRAY_BUFFER, rendererID);
+        gl_bind_array_buffer(rendererID);
     }
-    virtual void unbind() const override { glBindBuffer(GL_ARRAY_BUFFER, 0); }
+    virtual void unbind() const override { gl_bind_array_buffer(0); }
     virtual void setLayout(const BufferLayout& l) override { layout = l; }
     virtual void setData(void* data, int size) override {
-        glBindBuffer(GL_ARRAY_BUFFER, rendererID);
+        gl_bind_array_buffer(rendererID);
         glBufferSubData(GL_ARRAY_BUFFER, 0, size, data);
     }
+    virtual void setSubData(void* data, int size, int offset) override {
+        gl_bind_array_buffer(rendererID);
+        glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+    }
+};
+
+struct OpenGLStreamingVertexBuffer : public StreamingVertexBuffer {
+    unsigned int rendererID;
+    // Only set when ARB_buffer_storage is around, in that case the
+    // whole buffer stays mapped for its entire life
+    uint8_t* persistent = nullptr;
+    std::array<GLsync, NUM_FRAMES> fences = {nullptr};
+
+    OpenGLStreamingVertexBuffer(int size, int batchesPerFrame)
+        : StreamingVertexBuffer(size, batchesPerFrame) {
+        glGenBuffers(1, &rendererID);
+        gl_bind_array_buffer(rendererID);
+        if (GLEW_ARB_buffer_storage) {
+            GLbitfield flags =
+                GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_ARRAY_BUFFER, totalSize(), nullptr, flags);
+            persistent = (uint8_t*)glMapBufferRange(GL_ARRAY_BUFFER, 0,
+                                                    totalSize(), flags);
+        } else {
+            // no buffer storage (hello macos) so we map each batch when
+            // we need it, the fences make the unsynchronized map safe
+            glBufferData(GL_ARRAY_BUFFER, totalSize(), nullptr,
+                         GL_STREAM_DRAW);
+        }
+    }
+
+    virtual ~OpenGLStreamingVertexBuffer() {
+        for (GLsync fence : fences) {
+            if (fence) glDeleteSync(fence);
+        }
+        if (persistent || mapped) {
+            gl_bind_array_buffer(rendererID);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
+        GLState::get().forgetBuffer(rendererID);
+        glDeleteBuffers(1, &rendererID);
+    }
+
+    virtual void bind() const override {
+        gl_bind_array_buffer(rendererID);
+    }
+    virtual void unbind() const override { gl_bind_array_buffer(0); }
+
+   protected:
+    virtual void fence_segment(int s) override {
+        if (fences[s]) glDeleteSync(fences[s]);
+        fences[s] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    virtual void wait_for_segment(int s) override {
+        GLsync fence = fences[s];
+        if (!fence) return;
+
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED) {
+            stats.stalls++;
+            auto start = std::chrono::high_resolution_clock::now();
+            while (result == GL_TIMEOUT_EXPIRED) {
+                // 1ms at a time
+                result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                          1000000);
+            }
+            stats.stallTime += std::chrono::duration<float>(
+                                   std::chrono::high_resolution_clock::now() -
+                                   start)
+                                   .count();
+        }
+        glDeleteSync(fence);
+        fences[s] = nullptr;
+    }
+
+    virtual void* map_range(int offset, int size) override {
+        if (persistent) return persistent + offset;
+        gl_bind_array_buffer(rendererID);
+        return glMapBufferRange(GL_ARRAY_BUFFER, offset, size,
+                                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                                    GL_MAP_UNSYNCHRONIZED_BIT);
+    }
+
+    virtual void unmap_range(int) override {
+        // coherent mapping, the writes are already visible
+        if (persistent) return;
+        gl_bind_array_buffer(rendererID);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
 };
 
 struct OpenGLIndexBuffer : public IndexBuffer {
@@ -221,16 +537,232 @@ struct OpenGLIndexBuffer : public IndexBuffer {
         count = c;
 
         glGenBuffers(1, &rendererID);
-        glBindBuffer(GL_ARRAY_BUFFER, rendererID);
+        gl_bind_array_buffer(rendererID);
         glBufferData(GL_ARRAY_BUFFER, count * sizeof(unsigned int), i_s,
                      GL_STATIC_DRAW);
     }
-    virtual ~OpenGLIndexBuffer() { glDeleteBuffers(1, &rendererID); }
+    virtual ~OpenGLIndexBuffer() {
+        GLState::get().forgetBuffer(rendererID);
+        glDeleteBuffers(1, &rendererID);
+    }
+    // Not bound as GL_ELEMENT_ARRAY_BUFFER since that would change
+    // whatever vertex array is bound right now
+    virtual void setData(const unsigned int* i_s, unsigned int c) override {
+        M_ASSERT(c <= count, "too many indices for this IndexBuffer");
+        glBindBuffer(GL_COPY_WRITE_BUFFER, rendererID);
+        // orphan the old storage so we dont wait on draws still using it
+        glBufferData(GL_COPY_WRITE_BUFFER, count * sizeof(unsigned int),
+                     nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, 0, c * sizeof(unsigned int),
+                        i_s);
+    }
     virtual void bind() const override {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, rendererID);
+        gl_bind_element_buffer(rendererID);
     }
     virtual void unbind() const override {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        gl_bind_element_buffer(0);
+    }
+};
+
+struct OpenGLUniformBuffer : public UniformBuffer {
+    unsigned int rendererID;
+    OpenGLUniformBuffer(int s, unsigned int b) {
+        size = s;
+        binding = b;
+        glGenBuffers(1, &rendererID);
+        glBindBuffer(GL_UNIFORM_BUFFER, rendererID);
+        glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, rendererID);
+    }
+    virtual ~OpenGLUniformBuffer() { glDeleteBuffers(1, &rendererID); }
+    virtual void setData(const void* data, int s, int offset = 0) override {
+        M_ASSERT(offset + s <= size, "too much data for this UniformBuffer");
+        glBindBuffer(GL_UNIFORM_BUFFER, rendererID);
+        glBufferSubData(GL_UNIFORM_BUFFER, offset, s, data);
+    }
+};
+
+struct OpenGLFramebuffer : public Framebuffer {
+    std::array<int, 4> previousViewport = {0, 0, 0, 0};
+
+    OpenGLFramebuffer(const std::string& name, int w, int h) {
+        width = w;
+        height = h;
+        colorAttachment = std::make_shared<OpenGLTexture2D>(name, w, h);
+        colorAttachment->setData(nullptr);
+        // the OpenGLTexture2D constructor left it bound
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glGenFramebuffers(1, &rendererID);
+        glBindFramebuffer(GL_FRAMEBUFFER, rendererID);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_2D, colorAttachment->rendererID, 0);
+        M_ASSERT(glCheckFramebufferStatus(GL_FRAMEBUFFER) ==
+                     GL_FRAMEBUFFER_COMPLETE,
+                 fmt::format("Framebuffer {} is incomplete", name));
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+    virtual ~OpenGLFramebuffer() { glDeleteFramebuffers(1, &rendererID); }
+
+    virtual void bind() override {
+        glGetIntegerv(GL_VIEWPORT, previousViewport.data());
+        glBindFramebuffer(GL_FRAMEBUFFER, rendererID);
+        glViewport(0, 0, width, height);
+    }
+
+    virtual void unbind() override {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(previousViewport[0], previousViewport[1],
+                   previousViewport[2], previousViewport[3]);
+    }
+
+    virtual void resize(int w, int h) override {
+        width = w;
+        height = h;
+        colorAttachment->width = w;
+        colorAttachment->height = h;
+        // setData expects the texture to be bound
+        gl_bind_texture(0, colorAttachment->rendererID);
+        colorAttachment->setData(nullptr);
+    }
+};
+
+////// ////// ////// ////// ////// ////// ////// //////
+//      Null versions, these dont talk to the gpu at all
+//      and just record what they were asked to do
+////// ////// ////// ////// ////// ////// ////// //////
+
+struct NullVertexArray : public VertexArray {
+    NullVertexArray() { rendererID = RendererAPI::genNullID(); }
+    virtual void addVertexBuffer(
+        const std::shared_ptr<VertexBuffer>& vb) override {
+        M_ASSERT(vb->layout.elements.size(), "Layout cannot be empty");
+        nextAttribIndex += (int)vb->layout.elements.size();
+        vertexBuffers.push_back(vb);
+    }
+    virtual void setBufferOffset(size_t, uintptr_t) override {}
+    virtual void setIndexBuffer(
+        const std::shared_ptr<IndexBuffer>& ib) override {
+        indexBuffer = ib;
+    }
+    virtual ~NullVertexArray() {}
+    virtual void bind() const override {
+        if (!GLState::get().bindVertexArray(rendererID)) return;
+        RendererAPI::log.record(RenderCommandLog::BindVertexArray, rendererID);
     }
+    virtual void unbind() const override {}
 };
 
+struct NullVertexBuffer : public VertexBuffer {
+    unsigned int rendererID;
+    NullVertexBuffer(int size) {
+        rendererID = RendererAPI::genNullID();
+        RendererAPI::log.record(RenderCommandLog::SetData, rendererID, size);
+    }
+    virtual ~NullVertexBuffer() {}
+    virtual void bind() const override {
+        if (!GLState::get().bindArrayBuffer(rendererID)) return;
+        RendererAPI::log.record(RenderCommandLog::BindVertexBuffer,
+                                rendererID);
+    }
+    virtual void unbind() const override {}
+    virtual void setLayout(const BufferLayout& l) override { layout = l; }
+    virtual void setData(void*, int size) override {
+        RendererAPI::log.record(RenderCommandLog::SetData, rendererID, size);
+    }
+    virtual void setSubData(void*, int size, int) override {
+        RendererAPI::log.record(RenderCommandLog::SetData, rendererID, size);
+    }
+};
+
+struct NullStreamingVertexBuffer : public StreamingVertexBuffer {
+    unsigned int rendererID;
+    std::vector<uint8_t> data;
+    NullStreamingVertexBuffer(int size, int batchesPerFrame)
+        : StreamingVertexBuffer(size, batchesPerFrame) {
+        data.resize(totalSize());
+        rendererID = RendererAPI::genNullID();
+    }
+    virtual ~NullStreamingVertexBuffer() {}
+    virtual void bind() const override {
+        if (!GLState::get().bindArrayBuffer(rendererID)) return;
+        RendererAPI::log.record(RenderCommandLog::BindVertexBuffer,
+                                rendererID);
+    }
+    virtual void unbind() const override {}
+
+   protected:
+    virtual void fence_segment(int) override {}
+    virtual void wait_for_segment(int) override {}
+    virtual void* map_range(int offset, int) override {
+        return data.data() + offset;
+    }
+    // counted as an upload since thats what the gpu ends up reading
+    virtual void unmap_range(int size) override {
+        if (size) {
+            RendererAPI::log.record(RenderCommandLog::SetData, rendererID,
+                                    size);
+        }
+    }
+};
+
+struct NullIndexBuffer : public IndexBuffer {
+    unsigned int rendererID;
+    NullIndexBuffer(unsigned int c) {
+        count = c;
+        rendererID = RendererAPI::genNullID();
+        RendererAPI::log.record(RenderCommandLog::SetData, rendererID,
+                                count * sizeof(unsigned int));
+    }
+    virtual ~NullIndexBuffer() {}
+    virtual void setData(const unsigned int*, unsigned int c) override {
+        M_ASSERT(c <= count, "too many indices for this IndexBuffer");
+        RendererAPI::log.record(RenderCommandLog::SetData, rendererID,
+                                c * sizeof(unsigned int));
+    }
+    virtual void bind() const override {
+        if (!GLState::get().bindElementBuffer(rendererID)) return;
+        RendererAPI::log.record(RenderCommandLog::BindIndexBuffer,
+                                rendererID);
+    }
+    virtual void unbind() const override {}
+};
+
+struct NullUniformBuffer : public UniformBuffer {
+    unsigned int rendererID;
+    NullUniformBuffer(int s, unsigned int b) {
+        size = s;
+        binding = b;
+        rendererID = RendererAPI::genNullID();
+    }
+    virtual ~NullUniformBuffer() {}
+    virtual void setData(const void*, int s, int offset = 0) override {
+        M_ASSERT(offset + s <= size, "too much data for this UniformBuffer");
+        RendererAPI::log.record(RenderCommandLog::UploadUniform, rendererID, s);
+    }
+};
+
+struct NullFramebuffer : public Framebuffer {
+    NullFramebuffer(const std::string& name, int w, int h) {
+        rendererID = RendererAPI::genNullID();
+        width = w;
+        height = h;
+        colorAttachment = std::make_shared<NullTexture2D>(name, w, h);
+        colorAttachment->setData(nullptr);
+    }
+    virtual ~NullFramebuffer() {}
+    virtual void bind() override {
+        RendererAPI::log.record(RenderCommandLog::BindFramebuffer, rendererID);
+    }
+    virtual void unbind() override {
+        RendererAPI::log.record(RenderCommandLog::BindFramebuffer, 0);
+    }
+    virtual void resize(int w, int h) override {
+        width = w;
+        height = h;
+        colorAttachment->width = w;
+        colorAttachment->height = h;
+        colorAttachment->setData(nullptr);
+    }
+};
@@ -0,0 +1,212 @@
+#include "capture.h"
+
+#include <cstring>
+
+#include "renderer.h"
+#include "rendererapi.h"
+
+FrameCapture::~FrameCapture() {
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        stopping = true;
+    }
+    jobAdded.notify_all();
+    if (worker.joinable()) worker.join();
+    // the gl context is probably gone by now, so the pbos and fences
+    // just go with it
+}
+
+void FrameCapture::capture(const std::string& path) {
+    stats.requested++;
+    // endFrame() runs on the render thread, so this goes in the same packet
+    // as the frame its for
+    Renderer::enqueue([this, path] { requests.push_back(path); });
+}
+
+void FrameCapture::endFrame(int width, int height) {
+    prof give_me_a_name(__PROFILE_FUNC__);
+    if (RendererAPI::isNull()) {
+        if (!requests.empty()) {
+            log_warn("Cant capture frames with RendererAPI::API::Null, "
+                     "dropping {}",
+                     requests.size());
+            stats.failed += (int)requests.size();
+            requests.clear();
+        }
+        return;
+    }
+
+    // anything from an earlier frame that the gpu is done with
+    for (Readback& readback : readbacks) {
+        if (!readback.busy) continue;
+        GLenum result = glClientWaitSync(readback.fence, 0, 0);
+        if (result == GL_ALREADY_SIGNALED ||
+            result == GL_CONDITION_SATISFIED) {
+            retire(readback, false);
+        }
+    }
+
+    if (requests.empty() || width <= 0 || height <= 0) return;
+
+    Readback& readback = readbacks[nextReadback];
+    if (readback.busy) {
+        // both are still in flight, so this one has to wait
+        stats.stalls++;
+        retire(readback, true);
+    }
+    // every capture from this frame shares the one readback
+    readback.paths = std::move(requests);
+    requests.clear();
+    start_readback(readback, width, height);
+    nextReadback = (nextReadback + 1) % NUM_PBOS;
+}
+
+void FrameCapture::finish() {
+    if (!RendererAPI::isNull()) {
+        // oldest first, so the files come out in the order they were taken
+        for (int i = 0; i < NUM_PBOS; i++) {
+            Readback& readback = readbacks[(nextReadback + i) % NUM_PBOS];
+            if (readback.busy) retire(readback, true);
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(jobMutex);
+    jobsDone.wait(lock, [this] { return jobs.empty() && jobsRunning == 0; });
+}
+
+void FrameCapture::start_readback(Readback& readback, int width,
+                                  int height) {
+    readback.width = width;
+    readback.height = height;
+    if (!readback.pbo) glGenBuffers(1, &readback.pbo);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER, width * height * 4, nullptr,
+                 GL_STREAM_READ);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    // with a pack buffer bound this is just queued, it returns right away
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback.busy = true;
+    stats.readbacks++;
+}
+
+void FrameCapture::retire(Readback& readback, bool wait) {
+    if (wait) {
+        GLenum result = GL_TIMEOUT_EXPIRED;
+        while (result == GL_TIMEOUT_EXPIRED) {
+            // 1ms at a time
+            result = glClientWaitSync(readback.fence,
+                                      GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        }
+    }
+    glDeleteSync(readback.fence);
+    readback.fence = nullptr;
+    readback.busy = false;
+
+    const size_t size = (size_t)readback.width * readback.height * 4;
+    std::vector<uint8_t> pixels(size);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size,
+                                  GL_MAP_READ_BIT);
+    if (data) {
+        memcpy(pixels.data(), data, size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    if (!data) {
+        log_warn("Failed to map frame capture buffer, dropping {}",
+                 readback.paths.size());
+        stats.failed += (int)readback.paths.size();
+        readback.paths.clear();
+        return;
+    }
+
+    for (size_t i = 0; i < readback.paths.size(); i++) {
+        const bool last = i + 1 == readback.paths.size();
+        queue_job(EncodeJob{readback.paths[i], readback.width, readback.height,
+                            last ? std::move(pixels) : pixels});
+    }
+    readback.paths.clear();
+}
+
+void FrameCapture::queue_job(EncodeJob job) {
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        if (!worker.joinable()) {
+            worker = std::thread(&FrameCapture::worker_loop, this);
+        }
+        jobs.push_back(std::move(job));
+    }
+    jobAdded.notify_one();
+}
+
+void FrameCapture::worker_loop() {
+    while (true) {
+        EncodeJob job;
+        {
+            std::unique_lock<std::mutex> lock(jobMutex);
+            jobAdded.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            jobsRunning++;
+        }
+
+        // gl gives us the bottom row first
+        const int stride = job.width * 4;
+        std::vector<uint8_t> row(stride);
+        for (int y = 0; y < job.height / 2; y++) {
+            uint8_t* top = job.pixels.data() + (y * stride);
+            uint8_t* bottom =
+                job.pixels.data() + ((job.height - 1 - y) * stride);
+            memcpy(row.data(), top, stride);
+            memcpy(top, bottom, stride);
+            memcpy(bottom, row.data(), stride);
+        }
+
+        if (stbi_write_png(job.path.c_str(), job.width, job.height, 4,
+                           job.pixels.data(), stride)) {
+            stats.written++;
+            log_info("Saved frame capture to {}", job.path);
+        } else {
+            stats.failed++;
+            log_warn("Failed to write frame capture to {}", job.path);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(jobMutex);
+            jobsRunning--;
+        }
+        jobsDone.notify_all();
+    }
+}
+
+int FrameCapture::compare(const std::string& a, const std::string& b,
+                          int tolerance) {
+    int aw, ah, bw, bh, channels;
+    stbi_uc* apixels = stbi_load(a.c_str(), &aw, &ah, &channels, 4);
+    stbi_uc* bpixels = stbi_load(b.c_str(), &bw, &bh, &channels, 4);
+
+    int different = -1;
+    if (apixels && bpixels && aw == bw && ah == bh) {
+        different = 0;
+        for (int i = 0; i < aw * ah; i++) {
+            for (int c = 0; c < 4; c++) {
+                int diff = abs((int)apixels[i * 4 + c] - bpixels[i * 4 + c]);
+                if (diff > tolerance) {
+                    different++;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (apixels) stbi_image_free(apixels);
+    if (bpixels) stbi_image_free(bpixels);
+    return different;
+}
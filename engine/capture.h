@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pch.hpp"
+
+// Reads frames back from the gpu for screenshots and golden image tests
+//
+// glReadPixels into client memory waits for the gpu to finish the frame,
+// so instead it reads into one of NUM_PBOS pixel buffers and we only map
+// that a frame or two later when the copy is done. The PNG encoding runs
+// on a worker thread so the main thread never waits on stb either
+//
+// Only needs GL 2.1 + sync objects, so it works the same under software
+// GL (Mesa llvmpipe / OSMesa) for CI machines without a gpu
+//
+//     FrameCapture::get().capture("frame.png");  // anywhere in the frame
+//
+// App::run() calls endFrame() before swapping and finish() on the way out,
+// both on the thread with the gl context
+struct FrameCapture {
+    static constexpr int NUM_PBOS = 2;
+
+    struct Stats {
+        int requested = 0;
+        int readbacks = 0;
+        // times we had to wait on a readback because both pbos were busy
+        int stalls = 0;
+        std::atomic<int> written = 0;
+        std::atomic<int> failed = 0;
+    };
+    Stats stats;
+
+    static FrameCapture& get() {
+        static FrameCapture capture;
+        return capture;
+    }
+
+    ~FrameCapture();
+
+    // Saves whatever is on screen at the end of this frame to path
+    // (the frame being recorded, with a RenderThread)
+    void capture(const std::string& path);
+
+    // Call after everything for the frame was drawn, before the swap
+    void endFrame(int width, int height);
+
+    // Blocks until every requested capture is on disk
+    void finish();
+
+    // For golden image tests, how many pixels differ by more than
+    // tolerance in any channel. -1 if either image cant be loaded or
+    // they arent the same size
+    static int compare(const std::string& a, const std::string& b,
+                       int tolerance = 0);
+
+   private:
+    struct Readback {
+        std::vector<std::string> paths;
+        int width = 0;
+        int height = 0;
+        unsigned int pbo = 0;
+        GLsync fence = nullptr;
+        bool busy = false;
+    };
+
+    struct EncodeJob {
+        std::string path;
+        int width;
+        int height;
+        std::vector<uint8_t> pixels;
+    };
+
+    // capture() calls from the current frame
+    std::vector<std::string> requests;
+    std::array<Readback, NUM_PBOS> readbacks;
+    // oldest readback, also the next one we use
+    int nextReadback = 0;
+
+    std::thread worker;
+    std::mutex jobMutex;
+    std::condition_variable jobAdded;
+    std::condition_variable jobsDone;
+    std::deque<EncodeJob> jobs;
+    int jobsRunning = 0;
+    bool stopping = false;
+
+    FrameCapture() {}
+
+    void start_readback(Readback& readback, int width, int height);
+    void retire(Readback& readback, bool wait);
+    void queue_job(EncodeJob job);
+    void worker_loop();
+};
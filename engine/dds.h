@@ -0,0 +1,371 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "pch.hpp"
+
+// Reads the block compressed images out of a .dds file, ready for
+// glCompressedTexImage2D
+//
+// Only BC1 (DXT1), BC3 (DXT5) and BC7 (through the DX10 header), one 2d
+// image with or without its mip chain. No cubemaps, arrays or volumes
+//
+// DDS is top row first and our textures are bottom row first (stbi flips
+// pngs on load), block compressed data cant be flipped cheaply so export
+// your dds files flipped
+struct CompressedImage {
+    struct Level {
+        int width;
+        int height;
+        size_t offset;
+        size_t size;
+    };
+
+    std::string path;
+    unsigned int format = 0;
+    int width = 0;
+    int height = 0;
+    std::vector<Level> levels;
+    std::vector<uint8_t> data;
+
+    const uint8_t* levelData(size_t level) const {
+        return data.data() + levels[level].offset;
+    }
+};
+
+namespace dds {
+constexpr uint32_t MAGIC = 0x20534444;  // "DDS "
+constexpr uint32_t DDPF_FOURCC = 0x4;
+constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+
+// the parts of DXGI_FORMAT we read
+constexpr uint32_t DXGI_FORMAT_BC1_UNORM = 71;
+constexpr uint32_t DXGI_FORMAT_BC3_UNORM = 77;
+constexpr uint32_t DXGI_FORMAT_BC7_UNORM = 98;
+constexpr uint32_t DXGI_FORMAT_BC7_UNORM_SRGB = 99;
+constexpr uint32_t D3D10_RESOURCE_DIMENSION_TEXTURE2D = 3;
+// way past what any gpu takes, just keeps the int math below safe
+constexpr uint32_t MAX_SIZE = 1 << 16;
+
+constexpr uint32_t fourcc(const char (&code)[5]) {
+    return (uint32_t)code[0] | ((uint32_t)code[1] << 8) |
+           ((uint32_t)code[2] << 16) | ((uint32_t)code[3] << 24);
+}
+
+#pragma pack(push, 1)
+struct PixelFormat {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t masks[4];
+};
+
+struct Header {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];
+    PixelFormat pixelFormat;
+    uint32_t caps[4];
+    uint32_t reserved2;
+};
+
+struct HeaderDX10 {
+    uint32_t dxgiFormat;
+    uint32_t resourceDimension;
+    uint32_t miscFlag;
+    uint32_t arraySize;
+    uint32_t miscFlags2;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(Header) == 124, "dds header is 124 bytes");
+static_assert(sizeof(HeaderDX10) == 20, "dx10 header is 20 bytes");
+
+// 0 if we cant upload it
+inline unsigned int gl_format(const Header& header,
+                              const HeaderDX10* dx10) {
+    if (dx10) {
+        switch (dx10->dxgiFormat) {
+            case DXGI_FORMAT_BC1_UNORM:
+                return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+            case DXGI_FORMAT_BC3_UNORM:
+                return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            case DXGI_FORMAT_BC7_UNORM:
+                return GL_COMPRESSED_RGBA_BPTC_UNORM;
+            case DXGI_FORMAT_BC7_UNORM_SRGB:
+                return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+        }
+        return 0;
+    }
+    if (!(header.pixelFormat.flags & DDPF_FOURCC)) return 0;
+    if (header.pixelFormat.fourCC == fourcc("DXT1")) {
+        return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    }
+    if (header.pixelFormat.fourCC == fourcc("DXT5")) {
+        return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    }
+    return 0;
+}
+
+// a full mip chain down to 1x1, floor(log2(max(w, h))) + 1
+constexpr uint32_t max_levels(uint32_t width, uint32_t height) {
+    uint32_t size = std::max(width, height);
+    uint32_t levels = 1;
+    while (size > 1) {
+        size /= 2;
+        levels++;
+    }
+    return levels;
+}
+
+// every format here is 4x4 blocks, BC1 is 8 bytes a block and the
+// others are 16
+inline size_t level_size(unsigned int format, int width, int height) {
+    const size_t blockBytes =
+        format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ? 8 : 16;
+    const size_t blocksWide = std::max(1, (width + 3) / 4);
+    const size_t blocksHigh = std::max(1, (height + 3) / 4);
+    return blocksWide * blocksHigh * blockBytes;
+}
+}  // namespace dds
+
+// false (with a warning) if the file is missing, broken, or a format we
+// dont handle
+inline bool read_dds(const std::string& path, CompressedImage& image) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        log_warn("Failed to load dds {}, file not found", path);
+        return false;
+    }
+    const size_t fileSize = (size_t)file.tellg();
+    file.seekg(0, std::ios::beg);
+
+    uint32_t magic = 0;
+    dds::Header header;
+    if (fileSize < sizeof(magic) + sizeof(header) ||
+        !file.read((char*)&magic, sizeof(magic)) || magic != dds::MAGIC ||
+        !file.read((char*)&header, sizeof(header)) || header.size != 124) {
+        log_warn("Failed to load dds {}, its not a dds file", path);
+        return false;
+    }
+
+    dds::HeaderDX10 dx10;
+    bool hasDX10 = (header.pixelFormat.flags & dds::DDPF_FOURCC) &&
+                   header.pixelFormat.fourCC == dds::fourcc("DX10");
+    if (hasDX10) {
+        if (!file.read((char*)&dx10, sizeof(dx10)) ||
+            dx10.resourceDimension !=
+                dds::D3D10_RESOURCE_DIMENSION_TEXTURE2D ||
+            dx10.arraySize > 1) {
+            log_warn("Failed to load dds {}, only single 2d textures work",
+                     path);
+            return false;
+        }
+    }
+
+    image.format = dds::gl_format(header, hasDX10 ? &dx10 : nullptr);
+    if (!image.format) {
+        log_warn("Failed to load dds {}, only BC1, BC3 and BC7 are supported",
+                 path);
+        return false;
+    }
+
+    if (header.width == 0 || header.height == 0 ||
+        header.width > dds::MAX_SIZE || header.height > dds::MAX_SIZE) {
+        log_warn("Failed to load dds {}, its {}x{}", path, header.width,
+                 header.height);
+        return false;
+    }
+
+    image.path = path;
+    image.width = (int)header.width;
+    image.height = (int)header.height;
+    // the count comes from the file, a broken one shouldnt get to make
+    // billions of levels before the size check below catches it
+    const uint32_t maxLevels = dds::max_levels(header.width, header.height);
+    const int numLevels =
+        (header.flags & dds::DDSD_MIPMAPCOUNT)
+            ? (int)std::clamp(header.mipMapCount, 1u, maxLevels)
+            : 1;
+
+    image.levels.clear();
+    size_t offset = 0;
+    int w = image.width;
+    int h = image.height;
+    for (int i = 0; i < numLevels; i++) {
+        size_t size = dds::level_size(image.format, w, h);
+        image.levels.push_back(CompressedImage::Level{w, h, offset, size});
+        offset += size;
+        w = std::max(1, w / 2);
+        h = std::max(1, h / 2);
+    }
+
+    const size_t dataStart = (size_t)file.tellg();
+    if (fileSize - dataStart < offset) {
+        log_warn("Failed to load dds {}, its cut off ({} of {} bytes)", path,
+                 fileSize - dataStart, offset);
+        return false;
+    }
+    image.data.resize(offset);
+    file.read((char*)image.data.data(), offset);
+    return true;
+}
+
+// writes a dds with dataBytes of zeroed block data after the headers
+inline std::string test_write_dds(const char* name, uint32_t magic,
+                                  const dds::Header& header,
+                                  const dds::HeaderDX10* dx10,
+                                  size_t dataBytes) {
+    const std::string path =
+        (std::__fs::filesystem::temp_directory_path() / name).string();
+    std::ofstream os(path, std::ios::binary | std::ios::trunc);
+    os.write((const char*)&magic, sizeof(magic));
+    os.write((const char*)&header, sizeof(header));
+    if (dx10) os.write((const char*)dx10, sizeof(*dx10));
+    std::vector<char> data(dataBytes, 0);
+    os.write(data.data(), data.size());
+    return path;
+}
+
+inline dds::Header test_dds_header(int width, int height, int mips,
+                                   const char (&code)[5]) {
+    dds::Header header{};
+    header.size = 124;
+    header.width = (uint32_t)width;
+    header.height = (uint32_t)height;
+    if (mips) {
+        header.flags |= dds::DDSD_MIPMAPCOUNT;
+        header.mipMapCount = (uint32_t)mips;
+    }
+    header.pixelFormat.size = 32;
+    header.pixelFormat.flags = dds::DDPF_FOURCC;
+    header.pixelFormat.fourCC = dds::fourcc(code);
+    return header;
+}
+
+inline void test_dds_bc1_mip_chain() {
+    // 64x32 down to 1x1, 8 bytes a block
+    const size_t sizes[] = {1024, 256, 64, 16, 8, 8, 8};
+    const std::string path =
+        test_write_dds("test_bc1.dds", dds::MAGIC,
+                       test_dds_header(64, 32, 7, "DXT1"), nullptr, 1384);
+    CompressedImage image;
+    M_ASSERT(read_dds(path, image), "bc1 with mips should load");
+    M_ASSERT(image.format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,
+             "DXT1 should be bc1");
+    M_ASSERT(image.levels.size() == 7, "should read every mip");
+    size_t offset = 0;
+    for (size_t i = 0; i < image.levels.size(); i++) {
+        M_ASSERT(image.levels[i].size == sizes[i] &&
+                     image.levels[i].offset == offset,
+                 "mip sizes should be whole 4x4 blocks");
+        offset += sizes[i];
+    }
+    M_ASSERT(image.levels[6].width == 1 && image.levels[6].height == 1,
+             "the last mip should be 1x1");
+    M_ASSERT(image.data.size() == 1384, "should read all the block data");
+    std::__fs::filesystem::remove(path);
+}
+
+inline void test_dds_bc3_block_size() {
+    // no mip count flag means one level, even with mipMapCount set
+    dds::Header header = test_dds_header(8, 8, 0, "DXT5");
+    header.mipMapCount = 4;
+    const std::string path =
+        test_write_dds("test_bc3.dds", dds::MAGIC, header, nullptr, 64);
+    CompressedImage image;
+    M_ASSERT(read_dds(path, image), "bc3 should load");
+    M_ASSERT(image.levels.size() == 1, "no mip flag should be one level");
+    M_ASSERT(image.levels[0].size == 64, "bc3 should be 16 bytes a block");
+    std::__fs::filesystem::remove(path);
+}
+
+inline void test_dds_dx10_bc7() {
+    dds::HeaderDX10 dx10{};
+    dx10.dxgiFormat = dds::DXGI_FORMAT_BC7_UNORM;
+    dx10.resourceDimension = dds::D3D10_RESOURCE_DIMENSION_TEXTURE2D;
+    dx10.arraySize = 1;
+    // 5x5 still rounds up to 2x2 blocks
+    const std::string path =
+        test_write_dds("test_bc7.dds", dds::MAGIC,
+                       test_dds_header(5, 5, 0, "DX10"), &dx10, 64);
+    CompressedImage image;
+    M_ASSERT(read_dds(path, image), "bc7 through dx10 should load");
+    M_ASSERT(image.format == GL_COMPRESSED_RGBA_BPTC_UNORM,
+             "dxgi 98 should be bc7");
+    M_ASSERT(image.levels[0].size == 64, "partial blocks should round up");
+
+    dx10.arraySize = 2;
+    test_write_dds("test_bc7.dds", dds::MAGIC,
+                   test_dds_header(5, 5, 0, "DX10"), &dx10, 128);
+    M_ASSERT(!read_dds(path, image), "texture arrays arent supported");
+    std::__fs::filesystem::remove(path);
+}
+
+inline void test_dds_rejects_broken() {
+    CompressedImage image;
+    const dds::Header header = test_dds_header(16, 16, 3, "DXT1");
+    // 128 + 32 + 8 bytes of blocks, one short
+    std::string path = test_write_dds("test_cut.dds", dds::MAGIC, header,
+                                      nullptr, 167);
+    M_ASSERT(!read_dds(path, image), "cut off data should fail");
+    std::__fs::filesystem::remove(path);
+
+    path = test_write_dds("test_magic.dds", dds::fourcc("PNG "), header,
+                          nullptr, 168);
+    M_ASSERT(!read_dds(path, image), "a bad magic should fail");
+    std::__fs::filesystem::remove(path);
+
+    path = test_write_dds("test_dxt3.dds", dds::MAGIC,
+                          test_dds_header(16, 16, 0, "DXT3"), nullptr, 256);
+    M_ASSERT(!read_dds(path, image), "DXT3 isnt supported");
+    std::__fs::filesystem::remove(path);
+
+    M_ASSERT(!read_dds("does_not_exist.dds", image),
+             "a missing file should fail");
+}
+
+inline void test_dds_clamps_mip_count() {
+    M_ASSERT(dds::max_levels(64, 32) == 7 && dds::max_levels(1, 1) == 1 &&
+                 dds::max_levels(5, 3) == 3,
+             "max_levels should be floor(log2(max(w, h))) + 1");
+
+    // a broken count only gets the real chain, 8x8 is 4 levels of bc1
+    const std::string path = test_write_dds(
+        "test_mips.dds", dds::MAGIC, test_dds_header(8, 8, -1, "DXT1"),
+        nullptr, 56);
+    CompressedImage image;
+    M_ASSERT(read_dds(path, image), "a huge mip count should be clamped");
+    M_ASSERT(image.levels.size() == 4, "8x8 has 4 levels down to 1x1");
+    std::__fs::filesystem::remove(path);
+}
+
+inline void test_dds_rejects_empty() {
+    CompressedImage image;
+    const std::string path =
+        test_write_dds("test_empty.dds", dds::MAGIC,
+                       test_dds_header(0, 16, 0, "DXT1"), nullptr, 64);
+    M_ASSERT(!read_dds(path, image), "a 0 wide image should fail");
+    std::__fs::filesystem::remove(path);
+}
+
+inline void test_dds() {
+    test_dds_bc1_mip_chain();
+    test_dds_bc3_block_size();
+    test_dds_dx10_bc7();
+    test_dds_rejects_broken();
+    test_dds_clamps_mip_count();
+    test_dds_rejects_empty();
+}
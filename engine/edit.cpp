@@ -4,6 +4,7 @@
 
 #include <functional>
 
+#include "capture.h"
 #include "commands.h"
 
 struct ExitCommand {
@@ -14,6 +15,17 @@ struct ExitCommand {
     }
 };
 
+struct ScreenshotCommand {
+    int count = 0;
+    std::string operator()(const std::vector<std::string>& tokens) {
+        std::string path = tokens.empty()
+                               ? fmt::format("screenshot_{}.png", count++)
+                               : tokens[0];
+        FrameCapture::get().capture(path);
+        return fmt::format("saving {}", path);
+    }
+};
+
 void EditorCommands::init_default_commands() {
     // Register a bunch of commands that arent custom
     registerCommand("toggle_bool", ToggleBoolCommand<bool>(),
@@ -24,6 +36,8 @@ void EditorCommands::init_default_commands() {
     registerCommand("inc_float", IncrementValueCommand<float>(),
                     "Increment float by value; inc_float <varname> <value>");
     registerCommand("exit", ExitCommand(), "force quit the app");
+    registerCommand("screenshot", ScreenshotCommand(),
+                    "Save the next frame as a png; screenshot [path]");
     // TODO write / read from history files to keep commands from last run
 
     // intrinsic editor commands
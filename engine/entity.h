@@ -113,6 +113,22 @@ struct Entity {
         if (ro.textureName) textureName = ro.textureName.value();
         if (ro.center) center = ro.center.value();
 
+        // skip building the transform at all if the camera cant see us
+        // (only does anything with Renderer::setCulling(true))
+        glm::vec2 middle = position;
+        glm::vec2 extent = size / 2.f;
+        if (angle > 5.f) {
+            // the rotated quad is pushed off center a bit, see
+            // drawQuadRotated
+            extent = glm::vec2{glm::length(size) * 0.75f};
+        } else if (center) {
+            middle = position + (size / 2.f);
+        }
+        if (!Renderer::isVisible(middle - extent, middle + extent)) {
+            Renderer::noteCulled();
+            return;
+        }
+
         // computing angle transforms are expensive so
         // if the angle is under thresh, just render it square
         if (angle <= 5.f) {
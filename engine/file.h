@@ -10,24 +10,84 @@
 #define DEFAULT_PATH "/tmp"
 #endif
 
-// Searches recursively to try to find filename matching
-inline std::string find_absolute_path_recursively(
-    const std::string& starting_folder, const std::string& filename) {
-    if (!std::__fs::filesystem::exists(starting_folder)) return "";
-    for (auto const& entry :
-         std::__fs::filesystem::recursive_directory_iterator{starting_folder}) {
-        if (entry.path().filename() == filename) {
-            return entry.path().string();
+// filename -> where it is, for every folder we have looked things up in.
+// Walking the whole resource tree for every lookup gets slow once there
+// are a lot of assets, so each folder gets walked once and after that its
+// a hash lookup
+//
+// ResourceLocations::init() indexes the resources folder, anything else
+// gets indexed the first time its asked about. Files added after that
+// arent seen until you refresh() the folder
+struct FileIndex {
+    static FileIndex& get() {
+        static FileIndex index;
+        return index;
+    }
+
+    // walks folder unless its already indexed
+    void index(const std::string& folder) {
+        if (folders.contains(folder)) return;
+        refresh(folder);
+    }
+
+    // walks folder again even if it was indexed
+    void refresh(const std::string& folder) {
+        Files& files = folders[folder];
+        files.clear();
+        if (!std::__fs::filesystem::exists(folder)) return;
+
+        for (auto const& entry :
+             std::__fs::filesystem::recursive_directory_iterator{folder}) {
+            if (!entry.is_regular_file()) continue;
+            files[entry.path().filename().string()].push_back(
+                entry.path().string());
         }
+
+        for (auto const& [filename, paths] : files) {
+            if (paths.size() < 2) continue;
+            log_warn(
+                "{} has {} files called {}, lookups get the one whose parent "
+                "folder matches or {}",
+                folder, paths.size(), filename, paths[0]);
+        }
+        log_trace("Indexed {} files in {}", files.size(), folder);
     }
-    return "";
-}
+
+    // "" if theres no filename under folder. When there are a few with the
+    // same name, the one in a folder called parent wins
+    std::string find(const std::string& folder, const std::string& filename,
+                     const std::string& parent = "") {
+        index(folder);
+        const Files& files = folders[folder];
+        auto it = files.find(filename);
+        if (it == files.end()) return "";
+        if (!parent.empty()) {
+            for (const std::string& path : it->second) {
+                if (std::__fs::filesystem::path(path)
+                        .parent_path()
+                        .filename()
+                        .string() == parent) {
+                    return path;
+                }
+            }
+        }
+        return it->second[0];
+    }
+
+   private:
+    // filename -> every path its at
+    using Files = std::unordered_map<std::string, std::vector<std::string>>;
+    std::unordered_map<std::string, Files> folders;
+
+    FileIndex() {}
+};
 
 inline std::string get_absolute_path_to(const std::string& starting_folder,
                                         const std::string& path) {
     const auto p = std::__fs::filesystem::path(path);
-    const std::string abs_path =
-        find_absolute_path_recursively(starting_folder, p.filename().string());
+    const std::string abs_path = FileIndex::get().find(
+        starting_folder, p.filename().string(),
+        p.parent_path().filename().string());
     if (abs_path.empty()) {
         log_warn("Failed to find file {}", path);
         return "";
@@ -43,6 +103,68 @@ inline std::string get_absolute_path_to(const std::string& starting_folder,
     return abs_path;
 }
 
+inline std::string test_file_index_folder() {
+    namespace fs = std::__fs::filesystem;
+    const fs::path folder = fs::temp_directory_path() / "test_file_index";
+    fs::remove_all(folder);
+    for (const char* path :
+         {"a/shader.glsl", "b/shader.glsl", "c/unique.txt"}) {
+        fs::create_directories((folder / path).parent_path());
+        std::ofstream os(folder / path);
+        os << path;
+    }
+    return folder.string();
+}
+
+inline void test_file_index_duplicates() {
+    namespace fs = std::__fs::filesystem;
+    const std::string folder = test_file_index_folder();
+    const std::string a = (fs::path(folder) / "a/shader.glsl").string();
+    const std::string b = (fs::path(folder) / "b/shader.glsl").string();
+    FileIndex::get().refresh(folder);
+
+    M_ASSERT(FileIndex::get().find(folder, "unique.txt") ==
+                 (fs::path(folder) / "c/unique.txt").string(),
+             "a unique file should be found without a parent");
+    M_ASSERT(FileIndex::get().find(folder, "shader.glsl", "a") == a,
+             "the parent folder should pick between duplicates");
+    M_ASSERT(FileIndex::get().find(folder, "shader.glsl", "b") == b,
+             "the parent folder should pick between duplicates");
+    const std::string fallback =
+        FileIndex::get().find(folder, "shader.glsl", "nope");
+    M_ASSERT(fallback == a || fallback == b,
+             "an unknown parent should still find one of them");
+    M_ASSERT(FileIndex::get().find(folder, "missing.txt").empty(),
+             "missing files should be empty");
+    M_ASSERT(get_absolute_path_to(folder, "b/shader.glsl") == b,
+             "get_absolute_path_to should use the parent folder");
+    fs::remove_all(folder);
+}
+
+inline void test_file_index_refresh() {
+    namespace fs = std::__fs::filesystem;
+    const std::string folder = test_file_index_folder();
+    FileIndex::get().refresh(folder);
+
+    const fs::path added = fs::path(folder) / "c/added.txt";
+    std::ofstream(added) << "added";
+    M_ASSERT(FileIndex::get().find(folder, "added.txt").empty(),
+             "new files arent seen until a refresh");
+    FileIndex::get().refresh(folder);
+    M_ASSERT(FileIndex::get().find(folder, "added.txt") == added.string(),
+             "a refresh should pick up new files");
+
+    fs::remove_all(folder);
+    FileIndex::get().refresh(folder);
+    M_ASSERT(FileIndex::get().find(folder, "unique.txt").empty(),
+             "a folder thats gone should have nothing in it");
+}
+
+inline void test_file_index() {
+    test_file_index_duplicates();
+    test_file_index_refresh();
+}
+
 __attribute__((unused))  // TODO use this or remove it
 static void
 openNotification() {
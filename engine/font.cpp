@@ -14,25 +14,24 @@ std::shared_ptr<Texture> fetch_texture_for_phrase(const std::wstring phrase,
     // if we ever decide to split then be careful
     auto textureName = fmt::format("{}_{}", fontname, to_string(phrase));
 
-    if (TextureLibrary::get().hasMatchingTexture(textureName)) {
-        auto ptr = TextureLibrary::get_tex(textureName);
-        if (ptr) {
-            return ptr;
-        }
+    if (auto ptr = TextureLibrary::get().findCached(textureName)) {
+        return ptr;
     }
     // otherwise we have to generate it
 
     // Load font file or use default
     unsigned char* fontBuffer;
-    bool usingDefaultFont = false;
+    // only when we read it ourselves, the others arent ours
+    bool freeFontBuffer = false;
     if (std::strcmp(fontname, "default") == 0) {
         filename = DEFAULT_FONT;
         fontBuffer = const_cast<unsigned char*>(&g_default_font_data[0]);
-        usingDefaultFont = true;
     } else if (std::strcmp(fontname, "default_cjk") == 0) {
         filename = DEFAULT_CJK_FONT;
         fontBuffer = const_cast<unsigned char*>(&g_default_cjk_font_data[0]);
-        usingDefaultFont = true;
+    } else if (auto packed = getResourceLocations().find_in_pack(filename)) {
+        // stbtt only reads the font, it can use the mapped pack as is
+        fontBuffer = (unsigned char*)packed->data();
     } else {
         std::ifstream file(filename, std::ios::binary | std::ios::ate);
         std::streamsize size = file.tellg();
@@ -47,6 +46,7 @@ std::shared_ptr<Texture> fetch_texture_for_phrase(const std::wstring phrase,
             return nullptr;
         }
         fontBuffer = (unsigned char*)buffer;
+        freeFontBuffer = true;
     }
 
     /* Initialize font */
@@ -133,13 +133,13 @@ std::shared_ptr<Texture> fetch_texture_for_phrase(const std::wstring phrase,
     }
 
     std::shared_ptr<Texture> fontTexture =
-        std::make_shared<Texture2D>(textureName, bitmap_w, bitmap_h);
+        Texture2D::create(textureName, bitmap_w, bitmap_h);
     fontTexture->setBitmapData(bitmap);
     fontTexture->tilingFactor = 1.f;
     fontTexture->temporary = temporary;
     TextureLibrary::get().add(fontTexture);
 
-    if (!usingDefaultFont) free(fontBuffer);
+    if (freeFontBuffer) free(fontBuffer);
     free(bitmap);
     return fontTexture;
 }
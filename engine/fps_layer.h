@@ -23,14 +23,26 @@ struct FPSLayer : public Layer {
         return text;
     }
 
-    virtual void onUpdate(Time dt) override {
-        prof give_me_a_name(__PROFILE_FUNC__);
-        (void)dt;
+    virtual void onUpdate(Time dt) override { (void)dt; }
+
+    virtual bool splitsRender() const override { return true; }
 
+    // glText is straight gl, so it has to happen wherever the context is
+    virtual void onRender() override {
         if (isMinimized) {
             return;
         }
+        const int x = App::getSettings().width - 320;
+        // copied here on the main thread, the render thread is busy
+        // counting the next frame into Renderer::stats
+        const bool hasAtlas = TextureLibrary::get().atlasStats.pages > 0;
+        Renderer::enqueue([this, x, stats = Renderer::frameStats, hasAtlas] {
+            drawStats(x, stats, hasAtlas);
+        });
+    }
 
+    void drawStats(int x, const Renderer::Statistics& stats, bool hasAtlas) {
+        prof give_me_a_name(__PROFILE_FUNC__);
         int y = 10;
         float scale = 1.f;
         gltInit();
@@ -38,17 +50,45 @@ struct FPSLayer : public Layer {
         gltColor(1.0f, 1.0f, 1.0f, 1.0f);
         std::vector<GLTtext*> texts;
 
-        auto avgRenderTime =
-            Renderer::stats.totalFrameTime / Renderer::stats.renderTimes.size();
+        auto avgRenderTime = stats.totalFrameTime / stats.renderTimes.size();
         texts.push_back(
             drawText(fmt::format("Avg render time {:.4f} ms ({:.2f} fps)",
                                  avgRenderTime, 1.f / avgRenderTime),
-                     App::getSettings().width - 320, y, scale));
+                     x, y, scale));
         y += 30;
 
+        texts.push_back(drawText(
+            fmt::format("Buffer stalls {} ({:.4f} ms)",
+                        stats.bufferStalls, stats.bufferStallTime * 1000.f),
+            x, y, scale));
+        y += 30;
+
+        texts.push_back(
+            drawText(fmt::format("Redundant gl calls skipped {}",
+                                 stats.skippedStateCalls),
+                     x, y, scale));
+        y += 30;
+
+        if (stats.culledQuads) {
+            texts.push_back(
+                drawText(fmt::format("Culled {} quads", stats.culledQuads), x,
+                         y, scale));
+            y += 30;
+        }
+
+        if (hasAtlas) {
+            texts.push_back(drawText(
+                fmt::format("Atlas saved {} slots (~{} batches)",
+                            stats.atlasSlotsSaved, stats.atlasBatchesSaved()),
+                x, y, scale));
+            y += 30;
+        }
+
         gltEndDraw();
         for (auto text : texts) gltDeleteText(text);
         gltTerminate();
+        // glText binds its own program, vao and textures
+        GLState::get().invalidate();
     }
 
     virtual void onEvent(Event& event) override {
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <array>
+
+#include "pch.hpp"
+
+// Shadow copy of the gl bindings we change the most, so binding something
+// thats already bound doesnt cost a driver call
+//
+// All the binds in the engine ask here first. If something outside the
+// engine touches gl directly (glText in the FPSLayer for example) call
+// invalidate() after it so we dont trust stale values
+//
+// With RendererAPI::API::Null the ids are the fake ones, so the same
+// calls get skipped and the bench sees the same savings
+struct GLState {
+    // something we havent set (or cant know), never matches a real id
+    static constexpr unsigned int UNKNOWN = 0xffffffff;
+    static constexpr int MAX_UNITS = 32;
+
+    unsigned int program = UNKNOWN;
+    unsigned int vertexArray = UNKNOWN;
+    unsigned int arrayBuffer = UNKNOWN;
+    // part of the vertex array state, so it resets when that changes
+    unsigned int elementBuffer = UNKNOWN;
+    unsigned int activeUnit = UNKNOWN;
+    std::array<unsigned int, MAX_UNITS> textures;
+    // GL_TEXTURE_2D_ARRAY has its own binding on every unit
+    std::array<unsigned int, MAX_UNITS> arrayTextures;
+
+    // binds we skipped, see Renderer::Statistics::redundantStateCalls
+    int skipped = 0;
+
+    GLState() { invalidate(); }
+
+    static GLState& get() {
+        static GLState state;
+        return state;
+    }
+
+    void invalidate() {
+        program = UNKNOWN;
+        vertexArray = UNKNOWN;
+        arrayBuffer = UNKNOWN;
+        elementBuffer = UNKNOWN;
+        activeUnit = UNKNOWN;
+        textures.fill(UNKNOWN);
+        arrayTextures.fill(UNKNOWN);
+    }
+
+    // All of these return true when the caller has to make the gl call
+
+    bool useProgram(unsigned int id) { return change(program, id); }
+
+    bool bindVertexArray(unsigned int id) {
+        if (!change(vertexArray, id)) return false;
+        elementBuffer = UNKNOWN;
+        return true;
+    }
+
+    bool bindArrayBuffer(unsigned int id) { return change(arrayBuffer, id); }
+
+    bool bindElementBuffer(unsigned int id) {
+        return change(elementBuffer, id);
+    }
+
+    bool activeTexture(int unit) {
+        return change(activeUnit, (unsigned int)unit);
+    }
+
+    bool bindTexture(int unit, unsigned int id) {
+        if (unit < 0 || unit >= MAX_UNITS) return true;
+        return change(textures[unit], id);
+    }
+
+    bool bindTextureArray(int unit, unsigned int id) {
+        if (unit < 0 || unit >= MAX_UNITS) return true;
+        return change(arrayTextures[unit], id);
+    }
+
+    // gl unbinds deleted objects (from the current context) for us,
+    // and their ids can be handed out again
+    void forgetProgram(unsigned int id) {
+        if (program == id) program = UNKNOWN;
+    }
+
+    void forgetVertexArray(unsigned int id) {
+        if (vertexArray == id) vertexArray = 0;
+    }
+
+    void forgetBuffer(unsigned int id) {
+        if (arrayBuffer == id) arrayBuffer = 0;
+        if (elementBuffer == id) elementBuffer = 0;
+    }
+
+    void forgetTexture(unsigned int id) {
+        for (auto& texture : textures) {
+            if (texture == id) texture = 0;
+        }
+        for (auto& texture : arrayTextures) {
+            if (texture == id) texture = 0;
+        }
+    }
+
+   private:
+    bool change(unsigned int& current, unsigned int id) {
+        if (current == id) {
+            skipped++;
+            return false;
+        }
+        current = id;
+        return true;
+    }
+};
+
+// The gl calls we shadow, for the OpenGL classes
+inline void gl_use_program(unsigned int id) {
+    if (GLState::get().useProgram(id)) glUseProgram(id);
+}
+
+inline void gl_bind_vertex_array(unsigned int id) {
+    if (GLState::get().bindVertexArray(id)) glBindVertexArray(id);
+}
+
+inline void gl_bind_array_buffer(unsigned int id) {
+    if (GLState::get().bindArrayBuffer(id)) glBindBuffer(GL_ARRAY_BUFFER, id);
+}
+
+inline void gl_bind_element_buffer(unsigned int id) {
+    if (GLState::get().bindElementBuffer(id)) {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, id);
+    }
+}
+
+inline void gl_bind_texture(int unit, unsigned int id) {
+    GLState& state = GLState::get();
+    // even when its already bound, callers edit the texture right after
+    // (setData, mipmaps, framebuffer resize) through the active unit
+    if (state.activeTexture(unit)) glActiveTexture(GL_TEXTURE0 + unit);
+    if (!state.bindTexture(unit, id)) return;
+    glBindTexture(GL_TEXTURE_2D, id);
+}
+
+inline void gl_bind_texture_array(int unit, unsigned int id) {
+    GLState& state = GLState::get();
+    // same as gl_bind_texture, the unit has to be active either way
+    if (state.activeTexture(unit)) glActiveTexture(GL_TEXTURE0 + unit);
+    if (!state.bindTextureArray(unit, id)) return;
+    glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+}
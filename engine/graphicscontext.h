@@ -8,6 +8,8 @@ struct GraphicsContext {
     virtual ~GraphicsContext() {}
     virtual void init() = 0;
     virtual void swapBuffers() = 0;
+    // so another thread can init() it
+    virtual void release() = 0;
 };
 
 struct OpenGLContext : public GraphicsContext {
@@ -15,4 +17,5 @@ struct OpenGLContext : public GraphicsContext {
     OpenGLContext(GLFWwindow* h) : handle(h) {}
     virtual void init() override { glfwMakeContextCurrent(handle); }
     virtual void swapBuffers() override { glfwSwapBuffers(handle); }
+    virtual void release() override { glfwMakeContextCurrent(nullptr); }
 };
@@ -22,6 +22,17 @@ struct Layer {
     virtual void onUpdate(Time elapsed) = 0;
     virtual void onEvent(Event& event) = 0;
 
+    // Opt in to the render thread (AppSettings::renderThread) by drawing
+    // in onRender() instead of onUpdate() and returning true here
+    //
+    // onRender() is called right after onUpdate() on the main thread either
+    // way, but with the render thread running the Renderer calls in it are
+    // only recorded, they hit the gpu while the next onUpdate() runs. So
+    // onRender() can read the layer state freely but shouldnt call gl
+    // directly, see Renderer::enqueue()
+    virtual bool splitsRender() const { return false; }
+    virtual void onRender() {}
+
     const std::string& getname() const { return name; }
 };
 
@@ -4,6 +4,7 @@
 #include <cstdlib>
 
 #include "edit.h"
+#include "renderer.h"
 
 // grahamScan
 // https://www.geeksforgeeks.org/dynamic-convex-hull-adding-points-existing-convex-hull/?ref=rp
@@ -245,6 +246,14 @@ struct NavMesh {
         }
     }
 
+    // all the shapes go in the same poly batch, so this is one draw call
+    // (unless there are more than Renderer can fit in a batch)
+    void render(const glm::vec4& color) const {
+        for (const Polygon& shape : shapes) {
+            Renderer::drawPolygon(shape.hull, color, true);
+        }
+    }
+
     bool overlap(Polygon a, Polygon b) const {
         // first check if the two max radii circles overlap
         for (size_t i = 0; i < a.points.size(); i++) {
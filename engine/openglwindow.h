@@ -37,9 +37,17 @@ struct OpenGLWindow : public Window {
 
     virtual void update() override {
         prof give_me_a_name(__PROFILE_FUNC__);
-        glfwPollEvents();
+        pollEvents();
+        swapBuffers();
+    }
+
+    virtual void pollEvents() override { glfwPollEvents(); }
+    virtual void swapBuffers() override {
+        prof give_me_a_name(__PROFILE_FUNC__);
         context->swapBuffers();
     }
+    virtual void makeContextCurrent() override { context->init(); }
+    virtual void releaseContext() override { context->release(); }
 
     virtual void setVSync(bool enabled) override {
         if (enabled) {
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define QUAD_TRANSFORM_SSE 1
+#endif
+
+#include "pch.hpp"
+//
+#include "texture.h"
+
+// Everything Renderer::drawQuads needs for one quad
+struct SpriteDesc {
+    // center of the quad
+    glm::vec3 position;
+    glm::vec2 size;
+    // radians, around the center
+    float rotation = 0.f;
+    glm::vec4 color = glm::vec4{1.f};
+    TextureHandle texture;
+    // if set, wins over texture
+    SubtextureHandle subtexture;
+};
+
+// Writes the 4 corners of each sprite into corners (so count * 4 of them)
+// in the same order drawQuad uses: bottom left, bottom right, top right,
+// top left
+inline void transform_sprite_corners_scalar(const SpriteDesc* sprites,
+                                            size_t count,
+                                            glm::vec3* corners) {
+    for (size_t i = 0; i < count; i++) {
+        const SpriteDesc& sprite = sprites[i];
+        // most sprites arent rotated, skip the trig for those
+        float r = sprite.rotation;
+        float c = r == 0.f ? 1.f : cosf(r);
+        float s = r == 0.f ? 0.f : sinf(r);
+        float hx = sprite.size.x * 0.5f;
+        float hy = sprite.size.y * 0.5f;
+
+        // half width along the rotated x axis, half height along y
+        float rx = c * hx, ry = s * hx;
+        float ux = -s * hy, uy = c * hy;
+
+        float px = sprite.position.x;
+        float py = sprite.position.y;
+        float pz = sprite.position.z;
+
+        glm::vec3* out = corners + (i * 4);
+        out[0] = glm::vec3{px - rx - ux, py - ry - uy, pz};
+        out[1] = glm::vec3{px + rx - ux, py + ry - uy, pz};
+        out[2] = glm::vec3{px + rx + ux, py + ry + uy, pz};
+        out[3] = glm::vec3{px - rx + ux, py - ry + uy, pz};
+    }
+}
+
+#ifdef QUAD_TRANSFORM_SSE
+// The loads below read straight out of SpriteDesc and the stores write
+// the corners as a flat float array, so both layouts have to be tight
+static_assert(offsetof(SpriteDesc, position) == 0);
+static_assert(offsetof(SpriteDesc, size) == 12);
+static_assert(offsetof(SpriteDesc, rotation) == 20);
+static_assert(sizeof(SpriteDesc) >= 32);
+static_assert(sizeof(glm::vec3) == 12);
+
+// Same as the scalar version, 4 sprites at a time
+//
+// SpriteDesc is AoS, so instead of gathering lanes one float at a time
+// this loads the first 8 floats of each sprite (position, size, rotation
+// and a bit of color) and transposes them into one register per field.
+// The corners go back out the same way, three transposes turn the
+// per corner x / y / z registers into 4 sprites worth of glm::vec3s
+inline void transform_sprite_corners_sse(const SpriteDesc* sprites,
+                                         size_t count, glm::vec3* corners) {
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 zero = _mm_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const SpriteDesc* s = sprites + i;
+
+        // px py pz sx
+        __m128 px = _mm_loadu_ps(&s[0].position.x);
+        __m128 py = _mm_loadu_ps(&s[1].position.x);
+        __m128 pz = _mm_loadu_ps(&s[2].position.x);
+        __m128 sx = _mm_loadu_ps(&s[3].position.x);
+        _MM_TRANSPOSE4_PS(px, py, pz, sx);
+
+        // sy rotation (then two floats of color we dont need)
+        __m128 sy = _mm_loadu_ps(&s[0].size.y);
+        __m128 rot = _mm_loadu_ps(&s[1].size.y);
+        __m128 unused0 = _mm_loadu_ps(&s[2].size.y);
+        __m128 unused1 = _mm_loadu_ps(&s[3].size.y);
+        _MM_TRANSPOSE4_PS(sy, rot, unused0, unused1);
+
+        __m128 hx = _mm_mul_ps(sx, half);
+        __m128 hy = _mm_mul_ps(sy, half);
+
+        // no sse trig, only the rotated lanes pay for it
+        __m128 c = _mm_set1_ps(1.f);
+        __m128 sn = zero;
+        if (_mm_movemask_ps(_mm_cmpneq_ps(rot, zero))) {
+            alignas(16) float r[4];
+            alignas(16) float cosv[4];
+            alignas(16) float sinv[4];
+            _mm_store_ps(r, rot);
+            for (int k = 0; k < 4; k++) {
+                cosv[k] = r[k] == 0.f ? 1.f : cosf(r[k]);
+                sinv[k] = r[k] == 0.f ? 0.f : sinf(r[k]);
+            }
+            c = _mm_load_ps(cosv);
+            sn = _mm_load_ps(sinv);
+        }
+
+        __m128 rx = _mm_mul_ps(c, hx);
+        __m128 ry = _mm_mul_ps(sn, hx);
+        __m128 ux = _mm_mul_ps(_mm_sub_ps(zero, sn), hy);
+        __m128 uy = _mm_mul_ps(c, hy);
+
+        // corner = p +/- r +/- u, same order of operations as the scalar
+        // version so both give the exact same floats
+        __m128 pmrx = _mm_sub_ps(px, rx), pmry = _mm_sub_ps(py, ry);
+        __m128 pprx = _mm_add_ps(px, rx), ppry = _mm_add_ps(py, ry);
+        __m128 x0 = _mm_sub_ps(pmrx, ux), y0 = _mm_sub_ps(pmry, uy);
+        __m128 x1 = _mm_sub_ps(pprx, ux), y1 = _mm_sub_ps(ppry, uy);
+        __m128 x2 = _mm_add_ps(pprx, ux), y2 = _mm_add_ps(ppry, uy);
+        __m128 x3 = _mm_add_ps(pmrx, ux), y3 = _mm_add_ps(pmry, uy);
+
+        // each sprite is 12 floats: x0 y0 z x1 | y1 z x2 y2 | z x3 y3 z
+        __m128 s0a = x0, s1a = y0, s2a = pz, s3a = x1;
+        _MM_TRANSPOSE4_PS(s0a, s1a, s2a, s3a);
+        __m128 s0b = y1, s1b = pz, s2b = x2, s3b = y2;
+        _MM_TRANSPOSE4_PS(s0b, s1b, s2b, s3b);
+        __m128 s0c = pz, s1c = x3, s2c = y3, s3c = pz;
+        _MM_TRANSPOSE4_PS(s0c, s1c, s2c, s3c);
+
+        float* out = &corners[i * 4].x;
+        _mm_storeu_ps(out + 0, s0a);
+        _mm_storeu_ps(out + 4, s0b);
+        _mm_storeu_ps(out + 8, s0c);
+        _mm_storeu_ps(out + 12, s1a);
+        _mm_storeu_ps(out + 16, s1b);
+        _mm_storeu_ps(out + 20, s1c);
+        _mm_storeu_ps(out + 24, s2a);
+        _mm_storeu_ps(out + 28, s2b);
+        _mm_storeu_ps(out + 32, s2c);
+        _mm_storeu_ps(out + 36, s3a);
+        _mm_storeu_ps(out + 40, s3b);
+        _mm_storeu_ps(out + 44, s3c);
+    }
+
+    // leftovers
+    transform_sprite_corners_scalar(sprites + i, count - i, corners + (i * 4));
+}
+#endif
+
+inline void transform_sprite_corners(const SpriteDesc* sprites, size_t count,
+                                     glm::vec3* corners) {
+#ifdef QUAD_TRANSFORM_SSE
+    transform_sprite_corners_sse(sprites, count, corners);
+#else
+    transform_sprite_corners_scalar(sprites, count, corners);
+#endif
+}
+
+inline void test_transform_sprite_corners_matches_scalar() {
+    // 4 at a time plus leftovers, rotated and not in the same group
+    std::vector<SpriteDesc> sprites(11);
+    for (size_t i = 0; i < sprites.size(); i++) {
+        sprites[i].position = {i * 1.5f, i * -0.25f, i * 0.1f};
+        sprites[i].size = {1.f + i, 2.f + i * 0.5f};
+        sprites[i].rotation = (i % 3 == 0) ? 0.f : i * 0.7f;
+    }
+    std::vector<glm::vec3> expected(sprites.size() * 4);
+    std::vector<glm::vec3> corners(sprites.size() * 4);
+    transform_sprite_corners_scalar(sprites.data(), sprites.size(),
+                                    expected.data());
+    transform_sprite_corners(sprites.data(), sprites.size(), corners.data());
+    for (size_t i = 0; i < corners.size(); i++) {
+        M_ASSERT(fabs(corners[i].x - expected[i].x) < 0.0001f &&
+                     fabs(corners[i].y - expected[i].y) < 0.0001f &&
+                     corners[i].z == expected[i].z,
+                 "every path should give the same corners");
+    }
+}
+
+inline void test_transform_sprite_corners_unrotated() {
+    SpriteDesc sprite;
+    sprite.position = {1.f, 2.f, 0.5f};
+    sprite.size = {2.f, 4.f};
+    std::array<SpriteDesc, 4> sprites = {sprite, sprite, sprite, sprite};
+    std::array<glm::vec3, 16> corners;
+    transform_sprite_corners(sprites.data(), sprites.size(), corners.data());
+    for (size_t i = 0; i < sprites.size(); i++) {
+        const glm::vec3* c = corners.data() + (i * 4);
+        M_ASSERT(c[0].x == 0.f && c[0].y == 0.f && c[0].z == 0.5f,
+                 "bottom left should be first");
+        M_ASSERT(c[1].x == 2.f && c[1].y == 0.f, "then bottom right");
+        M_ASSERT(c[2].x == 2.f && c[2].y == 4.f, "then top right");
+        M_ASSERT(c[3].x == 0.f && c[3].y == 4.f, "then top left");
+    }
+}
+
+inline void test_transform_sprite_corners() {
+    test_transform_sprite_corners_matches_scalar();
+    test_transform_sprite_corners_unrotated();
+}
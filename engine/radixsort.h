@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "log.h"
+
+// LSD radix sort for 64 bit keys, one byte per pass
+//
+// Sorts `indices` so that keys[indices[i]] is ascending. Its stable, so
+// two items with the same key keep the order they were submitted in.
+//
+// Passes where every key has the same byte are skipped, so keys that only
+// use a handful of bits (which is most sort keys) only cost a few passes.
+inline void radix_sort_indices(const std::vector<uint64_t>& keys,
+                               std::vector<uint32_t>& indices,
+                               std::vector<uint32_t>& scratch) {
+    const size_t n = keys.size();
+    indices.resize(n);
+    scratch.resize(n);
+    for (size_t i = 0; i < n; i++) indices[i] = (uint32_t)i;
+    if (n < 2) return;
+
+    for (int pass = 0; pass < 8; pass++) {
+        const int shift = pass * 8;
+
+        std::array<uint32_t, 256> counts = {0};
+        for (size_t i = 0; i < n; i++) {
+            counts[(keys[indices[i]] >> shift) & 0xff]++;
+        }
+
+        // all keys share this byte, nothing would move
+        if (counts[(keys[indices[0]] >> shift) & 0xff] == n) continue;
+
+        uint32_t total = 0;
+        for (auto& c : counts) {
+            uint32_t old = c;
+            c = total;
+            total += old;
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            uint32_t idx = indices[i];
+            scratch[counts[(keys[idx] >> shift) & 0xff]++] = idx;
+        }
+        indices.swap(scratch);
+    }
+}
+
+inline void test_radix_sort_empty_and_single() {
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> scratch;
+    radix_sort_indices(keys, indices, scratch);
+    M_ASSERT(indices.empty(), "no keys should give no indices");
+
+    keys = {42};
+    radix_sort_indices(keys, indices, scratch);
+    M_ASSERT(indices.size() == 1 && indices[0] == 0,
+             "a single key should give index 0");
+}
+
+inline void test_radix_sort_orders_keys() {
+    // bytes that differ in the low, middle and top of the key
+    std::vector<uint64_t> keys = {0x0100000000000000ull, 5, 0x300, 1, 0x200,
+                                  0xff00000000000000ull, 0};
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> scratch;
+    radix_sort_indices(keys, indices, scratch);
+
+    M_ASSERT(indices.size() == keys.size(), "every key should get an index");
+    for (size_t i = 1; i < indices.size(); i++) {
+        M_ASSERT(keys[indices[i - 1]] <= keys[indices[i]],
+                 "keys should come out ascending");
+    }
+    M_ASSERT(indices.front() == 6 && indices.back() == 5,
+             "smallest and largest keys should be at the ends");
+}
+
+inline void test_radix_sort_is_stable() {
+    // same key submitted several times should keep its submit order
+    std::vector<uint64_t> keys = {7, 3, 7, 3, 7, 3};
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> scratch;
+    radix_sort_indices(keys, indices, scratch);
+
+    const std::vector<uint32_t> expected = {1, 3, 5, 0, 2, 4};
+    M_ASSERT(indices == expected, "equal keys should keep their order");
+}
+
+inline void test_radix_sort_all_same() {
+    // every pass gets skipped, should still hand back 0..n
+    std::vector<uint64_t> keys(16, 0xabcdull);
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> scratch;
+    radix_sort_indices(keys, indices, scratch);
+    for (size_t i = 0; i < indices.size(); i++) {
+        M_ASSERT(indices[i] == i, "same keys should stay in submit order");
+    }
+}
+
+inline void test_radix_sort() {
+    test_radix_sort_empty_and_single();
+    test_radix_sort_orders_keys();
+    test_radix_sort_is_stable();
+    test_radix_sort_all_same();
+}
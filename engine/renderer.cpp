@@ -4,21 +4,42 @@
 #include "pch.hpp"
 
 Renderer::Statistics Renderer::stats;
+Renderer::Statistics Renderer::frameStats;
 Renderer::SceneData* Renderer::sceneData = new Renderer::SceneData;
+std::atomic<uint32_t> Renderer::arenaGeneration{1};
 
 INCBIN(char, flat_shader, "./resources/shaders/flat.glsl");
 INCBIN(char, line_shader, "./resources/shaders/line.glsl");
 INCBIN(char, poly_shader, "./resources/shaders/poly.glsl");
 INCBIN(char, texture_shader, "./resources/shaders/texture.glsl");
+INCBIN(char, texture_compact_shader,
+       "./resources/shaders/texture_compact.glsl");
+INCBIN(char, texture_array_shader, "./resources/shaders/texture_array.glsl");
+INCBIN(char, sprite_shader, "./resources/shaders/sprite.glsl");
 
 void Renderer::init_default_shaders() {
     Renderer::sceneData->shaderLibrary.load_binary("flat", g_flat_shader_data,
                                                    g_flat_shader_size);
     Renderer::sceneData->shaderLibrary.load_binary(
         "texture", g_texture_shader_data, g_texture_shader_size);
+    Renderer::sceneData->shaderLibrary.load_binary(
+        "texture_compact", g_texture_compact_shader_data,
+        g_texture_compact_shader_size);
+    Renderer::sceneData->shaderLibrary.load_binary(
+        "texture_array", g_texture_array_shader_data,
+        g_texture_array_shader_size);
+    Renderer::sceneData->shaderLibrary.load_binary(
+        "sprite", g_sprite_shader_data, g_sprite_shader_size);
     Renderer::sceneData->shaderLibrary.load_binary("line", g_line_shader_data,
                                                    g_line_shader_size);
     Renderer::sceneData->shaderLibrary.load_binary("poly", g_poly_shader_data,
                                                    g_poly_shader_size);
+
+    const ShaderCache::Stats& cacheStats = ShaderCache::get().stats;
+    if (cacheStats.hits || cacheStats.misses) {
+        log_info("Shader cache: {} hits, {} misses, saved {:.2f} ms",
+                 cacheStats.hits, cacheStats.misses,
+                 cacheStats.timeSaved * 1000.f);
+    }
 }
 
@@ -1,31 +1,38 @@
 
 
 #pragma once
+
+#include <atomic>
+#include <cfloat>
+#include <functional>
+#include <mutex>
+#include <thread>
 //
 #include "pch.hpp"
 //
 #include "buffer.h"
 #include "camera.h"
+#include "glstate.h"
+#include "quadtransform.h"
+#include "radixsort.h"
+#include "rendererapi.h"
 #include "shader.h"
 #include "texture.h"
+#include "triangulate.h"
 
 // TODO if there are ever any other renderers (directx vulcan metal)
 // then have to subclass this for each one
+//
+// Shares the Camera uniform block with Renderer, so Renderer::init() has
+// to have run first
 struct Renderer3D {
-    struct SceneData {
-        glm::mat4 viewProjection;
-    };
-
-    static SceneData* sceneData;
-
     static void init() {
         glEnable(GL_BLEND);
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     }
 
-    static void begin(OrthoCamera& cam) {
-        sceneData->viewProjection = cam.viewProjection;
-    }
+    // defined after Renderer, it writes Renderer's camera buffer
+    static void begin(OrthoCamera& cam);
     static void end() {}
 
     static void clear(const glm::vec4& color) {
@@ -38,7 +45,6 @@ struct Renderer3D {
                        const std::shared_ptr<Shader>& shader,
                        const glm::mat4& transform = glm::mat4(1.f)) {
         shader->bind();
-        shader->uploadUniformMat4("viewProjection", sceneData->viewProjection);
         shader->uploadUniformMat4("transformMatrix", transform);
 
         vertexArray->bind();
@@ -53,6 +59,8 @@ struct Renderer3D {
 
 static const char* DEFAULT_TEX = "white";
 static const int MAX_TEX = 16;
+// Texture2DArrays per batch, each one can have hundreds of layers
+static const int MAX_ARRAY_TEX = 4;
 static const glm::mat4 imat(1.f);
 struct Renderer {
     struct QuadVert {
@@ -63,6 +71,37 @@ struct Renderer {
         // float tilingfactor;
     };
 
+    // Same quad in 20 bytes instead of 40, see VertexFormat::Compact
+    struct CompactQuadVert {
+        glm::vec2 position;
+        // rgba8, see pack_unorm8x4
+        uint32_t color;
+        // 0 to 65535 is 0 to 1, see pack_unorm16
+        uint16_t texcoord[2];
+        // only [0] is used, the rest keeps the vertex 4 byte aligned
+        uint8_t texindex[4];
+    };
+    static_assert(sizeof(CompactQuadVert) == 20);
+
+    // For textures that live in a Texture2DArray
+    struct ArrayQuadVert {
+        glm::vec3 position;
+        glm::vec4 color;
+        glm::vec2 texcoord;
+        float layer;
+        // which of the arraySlots
+        float arrayindex;
+    };
+
+    enum class VertexFormat {
+        // QuadVert
+        Full,
+        // CompactQuadVert, half the bandwidth but:
+        // - no z, so depth only matters for SubmitMode::Sorted
+        // - 8 bit color, 16 bit texcoords (fine up to 65536 texels wide)
+        Compact,
+    };
+
     struct LineVert {
         glm::vec3 position;
         glm::vec4 color;
@@ -75,10 +114,26 @@ struct Renderer {
 
     struct Statistics {
         std::array<float, 100> renderTimes;
+        std::chrono::high_resolution_clock::time_point frameBegin;
         int drawCalls = 0;
         int quadCount = 0;
         int textureCount = 0;
+        // times we had to wait for the gpu before writing a batch
+        int bufferStalls = 0;
+        float bufferStallTime = 0.f;
+        // batches that didnt fit in their buffers frame segment, if this
+        // keeps going up give that buffer more batchesPerFrame
+        int bufferOverflows = 0;
+        // texture slots we would have needed if the images drawn from atlas
+        // pages were still separate textures
+        int atlasSlotsSaved = 0;
+        // quads (and sprites) that were outside the camera, see setCulling
+        int culledQuads = 0;
+        // quad vertex data written into the streaming buffer
+        size_t quadVertexBytes = 0;
         size_t frameCount = 0;
+        // only filled in on frameStats, stats reads GLState directly
+        int skippedStateCalls = 0;
         float frameBeginTime = 0.f;
         float totalFrameTime = 0.f;
 
@@ -86,13 +141,35 @@ struct Renderer {
             drawCalls = 0;
             quadCount = 0;
             textureCount = 0;
+            bufferStalls = 0;
+            bufferStallTime = 0.f;
+            bufferOverflows = 0;
+            atlasSlotsSaved = 0;
+            culledQuads = 0;
+            quadVertexBytes = 0;
+            GLState::get().skipped = 0;
         }
 
-        void begin() { frameBeginTime = (float)glfwGetTime(); }
+        // binds / program switches GLState skipped since the last reset
+        int redundantStateCalls() const { return GLState::get().skipped; }
+
+        // every batch can hold MAX_TEX - 1 textures (+ white) so this is
+        // a lower bound on how many flushes the atlas saved (its more when
+        // the draw order jumps between textures)
+        int atlasBatchesSaved() const {
+            return atlasSlotsSaved / (MAX_TEX - 1);
+        }
+
+        // Note: not using glfwGetTime() here so that stats
+        // still work when there is no window (RendererAPI::API::Null)
+        void begin() {
+            frameBegin = std::chrono::high_resolution_clock::now();
+        }
 
         void end() {
-            auto endt = (float)glfwGetTime();
-            renderTimes[frameCount] = endt - frameBeginTime;
+            auto endt = std::chrono::high_resolution_clock::now();
+            renderTimes[frameCount] =
+                std::chrono::duration<float>(endt - frameBegin).count();
             totalFrameTime +=
                 renderTimes[frameCount] -
                 renderTimes[(frameCount + 1) % renderTimes.size()];
@@ -103,7 +180,172 @@ struct Renderer {
         }
     };
 
+    // Counted by whichever thread renders (the RenderThread when there is
+    // one), so only read these from there
     static Statistics stats;
+    // The last finished frame, copied from stats by publishStats() while
+    // the render thread is idle, safe to read on the main thread
+    static Statistics frameStats;
+
+    // App::run does this at the frame handoff
+    static void publishStats() {
+        frameStats = stats;
+        frameStats.skippedStateCalls = stats.redundantStateCalls();
+    }
+
+    enum class SubmitMode {
+        // quads are written into the batch as soon as drawQuad is called
+        Immediate,
+        // quads are recorded with a sort key and only written into batches
+        // during end(), ordered by (layer, depth, shader, texture)
+        //
+        // Note: this means quads on the same layer and depth can be drawn
+        // in a different order than they were submitted, so if you need two
+        // overlapping transparent quads in a specific order, put them on
+        // different layers
+        //
+        // Only quads are sorted (drawQuad, drawQuads and drawSprite, which
+        // goes through drawQuad here). Lines and polygons keep their own
+        // batches and are drawn after the quads in the order they came in
+        Sorted,
+    };
+
+    // Everything needed to write a quad into a batch later
+    struct SortedQuad {
+        std::array<glm::vec3, 4> positions;
+        glm::vec4 color;
+        std::array<glm::vec2, 4> texcoords;
+        TextureHandle texture;
+    };
+
+    // Quads drawn from any thread other than the one that called init()
+    // are recorded here instead (one arena per thread) and merged into
+    // the real batches in end()
+    struct QuadArena {
+        std::vector<SortedQuad> quads;
+        // one per quad, only used if end() runs in SubmitMode::Sorted
+        std::vector<uint64_t> sortKeys;
+        uint8_t currentLayer = 0;
+        // added to stats.culledQuads when the arena is merged
+        int culledQuads = 0;
+        // its thread exited, dropped after the next merge
+        bool orphaned = false;
+    };
+
+    // thread_local in worker_arena(), hands the arena back when the
+    // worker thread exits so end() doesnt keep walking dead ones
+    struct WorkerArenaSlot {
+        QuadArena* arena = nullptr;
+        // arenas from before a shutdown() are already gone
+        uint32_t generation = 0;
+
+        ~WorkerArenaSlot() { release_worker_arena(*this); }
+    };
+
+    // One frame of drawing from the main thread while a RenderThread is
+    // running (see renderthread.h), played back on the render thread
+    //
+    // Quads are most of it so they go in one array, everything else is
+    // a call to make again on the render thread. Culling and sorting
+    // happen during playback, same as if they were drawn right away
+    struct FramePacket {
+        struct Command {
+            // empty for a run of quads
+            std::function<void()> call;
+            size_t firstQuad = 0;
+            size_t numQuads = 0;
+        };
+        std::vector<Command> commands;
+        std::vector<SortedQuad> quads;
+        // for the sort key in SubmitMode::Sorted
+        std::vector<float> depths;
+
+        // what isVisible() needs while recording, begin() and
+        // setCulling() keep these up to date
+        bool cullingEnabled = false;
+        bool hasCullRect = false;
+        glm::vec4 cullRect{0.f};
+        // culled while recording (see noteCulled), added to the stats
+        // when its played back
+        int culledQuads = 0;
+
+        // What the worker arenas held at each end(), moved in on the main
+        // thread so playback never touches a live arena
+        std::vector<SortedQuad> workerQuads;
+        std::vector<uint64_t> workerSortKeys;
+
+        // Every texture the packet draws with, by handle id. The main
+        // thread keeps adding and evicting while this plays back, so
+        // playback only ever looks in here (see resolve_texture)
+        std::vector<std::shared_ptr<Texture>> textures;
+        // TextureHandle::generation of each pinned texture, a handle
+        // from before an eviction still resolves to nothing
+        std::vector<uint32_t> generations;
+        // the ids set in textures, so clear() doesnt walk all of it
+        std::vector<uint32_t> pinned;
+
+        void call(std::function<void()> fn) {
+            commands.push_back(Command{std::move(fn)});
+        }
+
+        void quad(const std::array<glm::vec3, 4>& positions,
+                  const glm::vec4& color,
+                  const std::array<glm::vec2, 4>& texcoords,
+                  TextureHandle texture, float depth) {
+            if (commands.empty() || commands.back().call) {
+                commands.push_back(Command{nullptr, quads.size(), 0});
+            }
+            commands.back().numQuads++;
+            quads.push_back(SortedQuad{positions, color, texcoords, texture});
+            depths.push_back(depth);
+            pin(texture);
+        }
+
+        // Main thread only, refcount traffic is once per texture per frame
+        void pin(TextureHandle texture) {
+            const uint32_t id = texture.id;
+            if (id < textures.size() && textures[id]) return;
+            const TextureLibrary& library = TextureLibrary::get();
+            const std::shared_ptr<Texture>& resolved =
+                library.resolve(texture);
+            // evicted already (or stale), draws white
+            if (!resolved) return;
+            if (id >= textures.size()) {
+                textures.resize(library.textureHandles.size());
+                generations.resize(library.textureHandles.size());
+            }
+            textures[id] = resolved;
+            generations[id] = texture.generation;
+            pinned.push_back(id);
+        }
+
+        // keeps the capacity so recording doesnt allocate after a few
+        // frames (other than whatever the calls capture)
+        void clear() {
+            commands.clear();
+            quads.clear();
+            depths.clear();
+            culledQuads = 0;
+            workerQuads.clear();
+            workerSortKeys.clear();
+            for (uint32_t id : pinned) textures[id].reset();
+            pinned.clear();
+        }
+    };
+
+    // One of these per sprite, the vertex shader expands it into a quad
+    // 60 bytes vs 4 * 40 for the same quad as QuadVerts
+    struct SpriteInstance {
+        // center of the sprite
+        glm::vec3 position;
+        glm::vec2 size;
+        // radians, around the center
+        float rotation;
+        glm::vec4 color;
+        // min.x, min.y, max.x, max.y
+        glm::vec4 uvRect;
+        float texindex;
+    };
 
     struct SceneData {
         // Max per draw call
@@ -112,34 +354,119 @@ struct Renderer {
         const int MAX_IND = MAX_QUADS * 6;
 
         std::shared_ptr<VertexArray> quadVA;
-        std::shared_ptr<VertexBuffer> quadVB;
+        std::shared_ptr<StreamingVertexBuffer> quadVB;
 
         int quadIndexCount = 0;
+        // these point into the mapped batch of the streaming buffers,
+        // null until something is written this batch (see ensure_mapped)
         QuadVert* qvbufferstart = nullptr;
         QuadVert* qvbufferptr = nullptr;
 
+        // only the buffer for the current vertexFormat gets written,
+        // both share the quad index buffer
+        VertexFormat vertexFormat = VertexFormat::Full;
+        std::shared_ptr<VertexArray> compactQuadVA;
+        std::shared_ptr<StreamingVertexBuffer> compactQuadVB;
+        CompactQuadVert* cqvbufferstart = nullptr;
+        CompactQuadVert* cqvbufferptr = nullptr;
+
+        // quads whose texture is a TextureArrayLayer, they get their own
+        // draw (after the normal quads) so they never use up textureSlots
+        std::shared_ptr<VertexArray> arrayQuadVA;
+        std::shared_ptr<StreamingVertexBuffer> arrayQuadVB;
+        int arrayIndexCount = 0;
+        ArrayQuadVert* aqvbufferstart = nullptr;
+        ArrayQuadVert* aqvbufferptr = nullptr;
+        std::array<std::shared_ptr<Texture2DArray>, MAX_ARRAY_TEX> arraySlots;
+        int nextArraySlot = 0;
+
+        const int MAX_SPRITES = 10000;
+        std::shared_ptr<VertexArray> spriteVA;
+        std::shared_ptr<StreamingVertexBuffer> spriteVB;
+
+        int spriteCount = 0;
+        SpriteInstance* sibufferstart = nullptr;
+        SpriteInstance* sibufferptr = nullptr;
+
         std::shared_ptr<VertexArray> lineVA;
-        std::shared_ptr<VertexBuffer> lineVB;
+        std::shared_ptr<StreamingVertexBuffer> lineVB;
 
         int lineVertexCount = 0;
         LineVert* lvbufferstart = nullptr;
         LineVert* lvbufferptr = nullptr;
+        // in pixels, anything over 1 is drawn as quads (see drawLine)
+        float lineThickness = 1.f;
+        // size of one pixel in world units for the current OrthoCamera,
+        // 0 when we dont know it
+        float worldPerPixel = 0.f;
+        glm::vec2 viewportSize{0.f, 0.f};
 
         std::shared_ptr<VertexArray> polyVA;
-        std::shared_ptr<VertexBuffer> polyVB;
+        std::shared_ptr<StreamingVertexBuffer> polyVB;
 
         int polyVertexCount = 0;
         PolyVert* pvbufferstart = nullptr;
         PolyVert* pvbufferptr = nullptr;
+        // triangulated on the cpu, uploaded to polyIB once per batch
+        std::vector<uint32_t> polyIndices;
+        std::shared_ptr<IndexBuffer> polyIB;
 
         glm::mat4 viewProjection;
+        // holds viewProjection for every shader with a Camera block
+        std::shared_ptr<UniformBuffer> cameraUBO;
+
+        bool cullingEnabled = false;
+        // world space rect the camera can see (min.x, min.y, max.x, max.y)
+        // only OrthoCameras set this, theres nothing to cull against
+        // for a FreeCamera
+        bool hasCullRect = false;
+        glm::vec4 cullRect;
 
         ShaderLibrary shaderLibrary;
-        std::array<std::shared_ptr<Texture2D>, MAX_TEX> textureSlots;
+        // looked up once in init() so flush doesnt go through the library
+        std::shared_ptr<Shader> textureShader;
+        std::shared_ptr<Shader> textureCompactShader;
+        std::shared_ptr<Shader> textureArrayShader;
+        std::shared_ptr<Shader> spriteShader;
+        std::shared_ptr<Shader> lineShader;
+        std::shared_ptr<Shader> polyShader;
+        std::array<std::shared_ptr<Texture>, MAX_TEX> textureSlots;
         int nextTexSlot = 1;  // 0 will be white
+        TextureHandle whiteTexture;
+
+        // handle id -> index in textureSlots
+        // only valid when handleSlotBatch matches the current batchID
+        // so we never have to clear it between batches
+        std::vector<int> handleSlot;
+        std::vector<uint32_t> handleSlotBatch;
+        uint32_t batchID = 1;
+
+        // atlas image id -> batchID it was last drawn in, for stats only
+        std::vector<uint32_t> atlasImageBatch;
+        int atlasImagesInBatch = 0;
+
+        SubmitMode submitMode = SubmitMode::Immediate;
+        uint8_t currentLayer = 0;
+        std::vector<SortedQuad> sortedQuads;
+        std::vector<uint64_t> sortKeys;
+        std::vector<uint32_t> sortIndices;
+        std::vector<uint32_t> sortScratch;
+
+        // the thread that owns the gpu batches, set in init() and moved
+        // by RenderThread while workers read it in worker_arena()
+        std::atomic<std::thread::id> recordingThread;
+        // what replay() is playing back, textures come from it instead of
+        // the library while its set
+        const FramePacket* replaying = nullptr;
+        // so batches never have to look the white texture up by name
+        std::shared_ptr<Texture> white;
+        std::mutex arenaMutex;
+        std::vector<std::unique_ptr<QuadArena>> arenas;
     };
 
     static SceneData* sceneData;
+    // bumped by shutdown(), see WorkerArenaSlot
+    static std::atomic<uint32_t> arenaGeneration;
 
     // TODO lets add something similar for shaders
     static void addTexture(const std::string& filepath) {
@@ -158,10 +485,12 @@ struct Renderer {
 
     static void init_default_textures() {
         std::shared_ptr<Texture> whiteTexture =
-            std::make_shared<Texture2D>("white", 1, 1);
+            Texture2D::create("white", 1, 1);
         unsigned int data = 0xffffffff;
         whiteTexture->setData(&data);
         TextureLibrary::get().add(whiteTexture);
+        sceneData->whiteTexture = whiteTexture->handle;
+        sceneData->white = whiteTexture;
 
         M_ASSERT(
             TextureLibrary::get().get("white"),
@@ -173,14 +502,13 @@ struct Renderer {
         std::shared_ptr<Shader> lineShader;
 
         sceneData->lineVA.reset(VertexArray::create());
-        sceneData->lineVB.reset(
-            VertexBuffer::create(sceneData->MAX_VERTS * sizeof(LineVert)));
+        sceneData->lineVB.reset(StreamingVertexBuffer::create(
+            sceneData->MAX_VERTS * sizeof(LineVert), 4));
         sceneData->lineVB->setLayout(BufferLayout{
             {"i_pos", BufferType::Float3},
             {"i_color", BufferType::Float4},
         });
         sceneData->lineVA->addVertexBuffer(sceneData->lineVB);
-        sceneData->lvbufferstart = new LineVert[sceneData->MAX_VERTS];
     }
 
     static void init_quad_buffers() {
@@ -189,8 +517,8 @@ struct Renderer {
         std::shared_ptr<IndexBuffer> quadIB;
 
         sceneData->quadVA.reset(VertexArray::create());
-        sceneData->quadVB.reset(
-            VertexBuffer::create(sceneData->MAX_VERTS * sizeof(QuadVert)));
+        sceneData->quadVB.reset(StreamingVertexBuffer::create(
+            sceneData->MAX_VERTS * sizeof(QuadVert), 8));
         sceneData->quadVB->setLayout(BufferLayout{
             {"i_pos", BufferType::Float3},
             {"i_color", BufferType::Float4},
@@ -199,8 +527,6 @@ struct Renderer {
         });
         sceneData->quadVA->addVertexBuffer(sceneData->quadVB);
 
-        sceneData->qvbufferstart = new QuadVert[sceneData->MAX_VERTS];
-
         uint32_t* quadIndices = new uint32_t[sceneData->MAX_IND];
         uint32_t offset = 0;
 
@@ -219,160 +545,675 @@ struct Renderer {
         quadIB.reset(IndexBuffer::create(quadIndices, sceneData->MAX_IND));
         sceneData->quadVA->setIndexBuffer(quadIB);
         delete[] quadIndices;
+
+        sceneData->compactQuadVA.reset(VertexArray::create());
+        sceneData->compactQuadVB.reset(StreamingVertexBuffer::create(
+            sceneData->MAX_VERTS * sizeof(CompactQuadVert), 8));
+        sceneData->compactQuadVB->setLayout(BufferLayout{
+            {"i_pos", BufferType::Float2},
+            {"i_color", BufferType::UByte4, true},
+            {"i_texcoord", BufferType::UShort2, true},
+            {"i_texindex", BufferType::UByte4},
+        });
+        sceneData->compactQuadVA->addVertexBuffer(sceneData->compactQuadVB);
+        sceneData->compactQuadVA->setIndexBuffer(quadIB);
+
+        sceneData->arrayQuadVA.reset(VertexArray::create());
+        sceneData->arrayQuadVB.reset(StreamingVertexBuffer::create(
+            sceneData->MAX_VERTS * sizeof(ArrayQuadVert), 4));
+        sceneData->arrayQuadVB->setLayout(BufferLayout{
+            {"i_pos", BufferType::Float3},
+            {"i_color", BufferType::Float4},
+            {"i_texcoord", BufferType::Float2},
+            {"i_layer", BufferType::Float},
+            {"i_arrayindex", BufferType::Float},
+        });
+        sceneData->arrayQuadVA->addVertexBuffer(sceneData->arrayQuadVB);
+        sceneData->arrayQuadVA->setIndexBuffer(quadIB);
     }
 
-    static void init_poly_buffers() {
-        std::shared_ptr<VertexBuffer> squareVB;
-        std::shared_ptr<IndexBuffer> squareIB;
-        std::shared_ptr<IndexBuffer> polyIB;
+    static void init_sprite_buffers() {
+        std::shared_ptr<VertexBuffer> cornerVB;
+        std::shared_ptr<IndexBuffer> spriteIB;
+
+        sceneData->spriteVA.reset(VertexArray::create());
+
+        float corners[] = {
+            -0.5f, -0.5f,  //
+            0.5f,  -0.5f,  //
+            0.5f,  0.5f,   //
+            -0.5f, 0.5f,   //
+        };
+        cornerVB.reset(VertexBuffer::create(corners, sizeof(corners)));
+        cornerVB->setLayout(BufferLayout{
+            {"i_corner", BufferType::Float2},
+        });
+        sceneData->spriteVA->addVertexBuffer(cornerVB);
+
+        sceneData->spriteVB.reset(StreamingVertexBuffer::create(
+            sceneData->MAX_SPRITES * sizeof(SpriteInstance), 2));
+        sceneData->spriteVB->setLayout(BufferLayout{
+            {"i_position", BufferType::Float3, false, 1},
+            {"i_size", BufferType::Float2, false, 1},
+            {"i_rotation", BufferType::Float, false, 1},
+            {"i_color", BufferType::Float4, false, 1},
+            {"i_uvrect", BufferType::Float4, false, 1},
+            {"i_texindex", BufferType::Float, false, 1},
+        });
+        sceneData->spriteVA->addVertexBuffer(sceneData->spriteVB);
+
+        unsigned int indices[] = {0, 1, 2, 2, 3, 0};
+        spriteIB.reset(IndexBuffer::create(indices, 6));
+        sceneData->spriteVA->setIndexBuffer(spriteIB);
+    }
 
+    static void init_poly_buffers() {
         sceneData->polyVA.reset(VertexArray::create());
-        sceneData->polyVB.reset(
-            VertexBuffer::create(sceneData->MAX_VERTS * sizeof(PolyVert)));
+        sceneData->polyVB.reset(StreamingVertexBuffer::create(
+            sceneData->MAX_VERTS * sizeof(PolyVert), 4));
         sceneData->polyVB->setLayout(BufferLayout{
             {"i_pos", BufferType::Float3},
             {"i_color", BufferType::Float4},
         });
         sceneData->polyVA->addVertexBuffer(sceneData->polyVB);
 
-        sceneData->pvbufferstart = new PolyVert[sceneData->MAX_VERTS];
-
-        uint32_t* polyIndices = new uint32_t[sceneData->MAX_IND];
-        uint32_t offset = 0;
-
-        for (int i = 0; i < sceneData->MAX_IND; i += 6) {
-            polyIndices[i + 0] = offset + 0;
-            polyIndices[i + 1] = offset + 1;
-            polyIndices[i + 2] = offset + 2;
-
-            polyIndices[i + 3] = offset + 2;
-            polyIndices[i + 4] = offset + 3;
-            polyIndices[i + 5] = offset + 0;
-
-            offset += 4;
-        }
-
-        polyIB.reset(IndexBuffer::create(polyIndices, sceneData->MAX_IND));
-        sceneData->polyVA->setIndexBuffer(polyIB);
-        delete[] polyIndices;
+        // filled in every batch by drawPolygon
+        sceneData->polyIndices.reserve(sceneData->MAX_IND);
+        sceneData->polyIB.reset(
+            IndexBuffer::create(nullptr, sceneData->MAX_IND));
+        sceneData->polyVA->setIndexBuffer(sceneData->polyIB);
     }
 
     static void init() {
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        // glEnable(GL_DEPTH_TEST);
-        glEnable(GL_LINE_SMOOTH);
-        glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
+        sceneData->recordingThread = std::this_thread::get_id();
+        RendererAPI::get().init();
         Renderer::setLineThickness(1.f);
 
         init_default_shaders();
         init_default_textures();
 
         init_quad_buffers();
+        init_sprite_buffers();
         init_line_buffers();
         init_poly_buffers();
+        init_camera_buffer();
+
+        sceneData->textureShader = sceneData->shaderLibrary.get("texture");
+        sceneData->textureCompactShader =
+            sceneData->shaderLibrary.get("texture_compact");
+        sceneData->textureArrayShader =
+            sceneData->shaderLibrary.get("texture_array");
+        sceneData->spriteShader = sceneData->shaderLibrary.get("sprite");
+        sceneData->lineShader = sceneData->shaderLibrary.get("line");
+        sceneData->polyShader = sceneData->shaderLibrary.get("poly");
 
         std::array<int, MAX_TEX> samples = {0};
         for (size_t i = 0; i < MAX_TEX; i++) {
             samples[(int)i] = (int)i;
         }
-        auto textureShader = sceneData->shaderLibrary.get("texture");
-        textureShader->bind();
-        textureShader->uploadUniformIntArray("u_textures", samples.data(),
-                                             MAX_TEX);
+        sceneData->textureShader->bind();
+        sceneData->textureShader->uploadUniformIntArray(
+            "u_textures", samples.data(), MAX_TEX);
+
+        sceneData->textureCompactShader->bind();
+        sceneData->textureCompactShader->uploadUniformIntArray(
+            "u_textures", samples.data(), MAX_TEX);
+
+        // sampler2DArrays are bound to GL_TEXTURE_2D_ARRAY, so sharing the
+        // units with the sampler2Ds in the other shaders is fine
+        sceneData->textureArrayShader->bind();
+        sceneData->textureArrayShader->uploadUniformIntArray(
+            "u_arrays", samples.data(), MAX_ARRAY_TEX);
+
+        sceneData->spriteShader->bind();
+        sceneData->spriteShader->uploadUniformIntArray(
+            "u_textures", samples.data(), MAX_TEX);
+    }
+
+    static void init_camera_buffer() {
+        sceneData->cameraUBO.reset(
+            UniformBuffer::create(sizeof(glm::mat4), CAMERA_UNIFORM_BINDING));
     }
 
     static void resize(int width, int height) {
-        glViewport(0, 0, width, height);
+        if (FramePacket* packet = recording_packet()) {
+            packet->call([width, height] { resize(width, height); });
+            return;
+        }
+        RendererAPI::get().setViewport(0, 0, width, height);
+        sceneData->viewportSize = glm::vec2{(float)width, (float)height};
     }
 
     static void shutdown() {
-        delete[] sceneData->qvbufferstart;
-        delete[] sceneData->lvbufferstart;
-        delete[] sceneData->pvbufferstart;
+        // every worker arena is owned by sceneData, so the slots still
+        // pointing at them have to forget them
+        arenaGeneration++;
         delete sceneData;
+        sceneData = nullptr;
     }
 
     static void clear(const glm::vec4& color) {
+        if (FramePacket* packet = recording_packet()) {
+            packet->call([color] { clear(color); });
+            return;
+        }
         prof(__PROFILE_FUNC__);
-        glClearColor(color.r, color.g, color.b, color.a);
-        glClear(GL_COLOR_BUFFER_BIT |
-                GL_DEPTH_BUFFER_BIT);  // Clear the buffers
+        RendererAPI::get().setClearColor(color);
+        RendererAPI::get().clear();
     }
 
     static void draw_INTERNAL(const std::shared_ptr<VertexArray>& vertexArray,
-                              int indexCount = 0) {
+                              int indexCount = 0, int baseVertex = 0) {
         prof give_me_a_name(__PROFILE_FUNC__);
         int count =
             indexCount ? indexCount : vertexArray->indexBuffer->getCount();
-        vertexArray->bind();
-        glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, nullptr);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        RendererAPI::get().drawIndexed(vertexArray, count, baseVertex);
     }
 
     static void drawPoly_INTERNAL(
-        const std::shared_ptr<VertexArray>& vertexArray, int indexCount = 0) {
+        const std::shared_ptr<VertexArray>& vertexArray, int indexCount = 0,
+        int baseVertex = 0) {
         prof give_me_a_name(__PROFILE_FUNC__);
         int count =
             indexCount ? indexCount : vertexArray->indexBuffer->getCount();
-        vertexArray->bind();
-        glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, nullptr);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        RendererAPI::get().drawIndexed(vertexArray, count, baseVertex);
+    }
+
+    static void drawSprites_INTERNAL(
+        const std::shared_ptr<VertexArray>& vertexArray, int instanceCount) {
+        prof give_me_a_name(__PROFILE_FUNC__);
+        RendererAPI::get().drawIndexedInstanced(
+            vertexArray, vertexArray->indexBuffer->getCount(), instanceCount);
     }
 
     static void drawLines_INTERNAL(
-        const std::shared_ptr<VertexArray>& vertexArray, int vertexCount) {
+        const std::shared_ptr<VertexArray>& vertexArray, int vertexCount,
+        int firstVertex = 0) {
         prof drlns(__PROFILE_FUNC__);
-        vertexArray->bind();
-        glDrawArrays(GL_LINES, 0, vertexCount);
+        RendererAPI::get().drawLines(vertexArray, vertexCount, firstVertex);
     }
 
     static void begin(OrthoCamera& cam) {
-        prof give_me_a_name(__PROFILE_FUNC__);
-        sceneData->viewProjection = cam.viewProjection;
-        _generic_begin();
+        begin_INTERNAL(cam.viewProjection, true);
     }
 
     static void begin(FreeCamera& cam) {
+        begin_INTERNAL(cam.getViewProjection(), false);
+    }
+
+    // only ortho cameras get a cull rect (and thick lines)
+    static void begin_INTERNAL(const glm::mat4& viewProjection, bool ortho) {
+        if (FramePacket* packet = recording_packet()) {
+            packet->hasCullRect = ortho;
+            if (ortho) packet->cullRect = view_rect(viewProjection);
+            packet->call([viewProjection, ortho] {
+                begin_INTERNAL(viewProjection, ortho);
+            });
+            return;
+        }
+
         prof give_me_a_name(__PROFILE_FUNC__);
-        sceneData->viewProjection = cam.getViewProjection();
+        sceneData->viewProjection = viewProjection;
+        sceneData->hasCullRect = ortho;
+        sceneData->worldPerPixel = 0.f;
+        if (ortho) {
+            sceneData->cullRect = view_rect(viewProjection);
+            if (sceneData->viewportSize.y > 0.f) {
+                sceneData->worldPerPixel =
+                    (sceneData->cullRect.w - sceneData->cullRect.y) /
+                    sceneData->viewportSize.y;
+            }
+        }
         _generic_begin();
     }
 
-    static void _generic_begin() {
-        auto textureShader = sceneData->shaderLibrary.get("texture");
-        textureShader->bind();
-        textureShader->uploadUniformMat4("viewProjection",
-                                         sceneData->viewProjection);
+    // When on, quads that are completely outside the OrthoCamera passed to
+    // begin() are dropped before they take up any room in the batch
+    //
+    // Off by default since anything drawn with a custom vertex shader (or
+    // outside the -1 to 1 depth range) might not end up where we think
+    static void setCulling(bool enabled) {
+        if (FramePacket* packet = recording_packet()) {
+            packet->cullingEnabled = enabled;
+            packet->call([enabled] { setCulling(enabled); });
+            return;
+        }
+        sceneData->cullingEnabled = enabled;
+    }
 
-        auto polyShader = sceneData->shaderLibrary.get("poly");
-        polyShader->bind();
-        polyShader->uploadUniformMat4("viewProjection",
-                                      sceneData->viewProjection);
+    // false if the world space box is completely outside the camera, always
+    // true when culling is off so you can use it to skip work before drawing
+    static bool isVisible(const glm::vec2& min, const glm::vec2& max) {
+        bool cullingEnabled = sceneData->cullingEnabled;
+        bool hasCullRect = sceneData->hasCullRect;
+        const glm::vec4* cullRect = &sceneData->cullRect;
+        if (const FramePacket* packet = recording_packet()) {
+            cullingEnabled = packet->cullingEnabled;
+            hasCullRect = packet->hasCullRect;
+            cullRect = &packet->cullRect;
+        }
+        if (!cullingEnabled || !hasCullRect) return true;
+        const glm::vec4& rect = *cullRect;
+        return !(max.x < rect.x || max.y < rect.y || min.x > rect.z ||
+                 min.y > rect.w);
+    }
 
+    // Maps the corners of clip space back into the world, with a rotated
+    // camera thats a rotated rect so we keep the box around it
+    static glm::vec4 view_rect(const glm::mat4& viewProjection) {
+        const glm::mat4 inv = glm::inverse(viewProjection);
+        const std::array<glm::vec4, 4> ndc = {{
+            {-1.f, -1.f, 0.f, 1.f},
+            {1.f, -1.f, 0.f, 1.f},
+            {1.f, 1.f, 0.f, 1.f},
+            {-1.f, 1.f, 0.f, 1.f},
+        }};
+        glm::vec2 min{FLT_MAX, FLT_MAX};
+        glm::vec2 max{-FLT_MAX, -FLT_MAX};
+        for (const glm::vec4& corner : ndc) {
+            glm::vec4 world = inv * corner;
+            glm::vec2 p{world.x / world.w, world.y / world.w};
+            min = glm::min(min, p);
+            max = glm::max(max, p);
+        }
+        return glm::vec4{min.x, min.y, max.x, max.y};
+    }
+
+    // true (and counted) if the quad can be skipped
+    static bool cull_quad(const glm::vec3* positions, QuadArena* arena) {
+        if (!sceneData->cullingEnabled || !sceneData->hasCullRect) return false;
+        glm::vec2 min{positions[0].x, positions[0].y};
+        glm::vec2 max = min;
+        for (size_t i = 1; i < 4; i++) {
+            min = glm::min(min, glm::vec2{positions[i].x, positions[i].y});
+            max = glm::max(max, glm::vec2{positions[i].x, positions[i].y});
+        }
+        if (isVisible(min, max)) return false;
+
+        // stats arent thread safe, workers count into their arena
+        if (arena) {
+            arena->culledQuads++;
+        } else {
+            stats.culledQuads++;
+        }
+        return true;
+    }
+
+    // Every begin() (game, ui, terminal...) just rewrites the one camera
+    // buffer, no program binds needed
+    static void _generic_begin() {
+        sceneData->cameraUBO->setData(&sceneData->viewProjection,
+                                      sizeof(glm::mat4));
         start_batch();
     }
 
+    // If you drew from other threads, they have to be done before this
     static void end() {
+        if (FramePacket* packet = recording_packet()) {
+            // the workers are done, take what they drew now so the render
+            // thread only ever sees the packets copy
+            const size_t first = packet->workerQuads.size();
+            drain_worker_arenas(*packet);
+            const size_t count = packet->workerQuads.size() - first;
+            packet->call([first, count] {
+                const FramePacket& replaying = *sceneData->replaying;
+                merge_quads(replaying.workerQuads.data() + first,
+                            replaying.workerSortKeys.data() + first, count);
+                end_INTERNAL();
+            });
+            return;
+        }
+        merge_worker_arenas();
+        end_INTERNAL();
+    }
+
+    static void end_INTERNAL() {
         prof give_me_a_name(__PROFILE_FUNC__);
+        if (sceneData->submitMode == SubmitMode::Sorted) {
+            flush_sorted();
+        }
         flush();
     }
 
+    // Once per frame after the last end(), puts one fence on everything
+    // the streaming buffers handed out this frame (App::run does this)
+    static void endFrame() {
+        // the library belongs to the main thread so this happens while
+        // recording, not on the render thread
+        TextureLibrary::get().recycleHandles();
+        if (FramePacket* packet = recording_packet()) {
+            packet->call([] { fence_stream_buffers(); });
+            return;
+        }
+        fence_stream_buffers();
+    }
+
+    static void fence_stream_buffers() {
+        for (const auto* buffer :
+             {&sceneData->quadVB, &sceneData->compactQuadVB,
+              &sceneData->arrayQuadVB, &sceneData->spriteVB,
+              &sceneData->lineVB, &sceneData->polyVB}) {
+            (*buffer)->endFrame();
+        }
+    }
+
+    // Should be called outside of begin() / end()
+    static void setSubmitMode(SubmitMode mode) {
+        if (FramePacket* packet = recording_packet()) {
+            packet->call([mode] { setSubmitMode(mode); });
+            return;
+        }
+        sceneData->submitMode = mode;
+    }
+
+    // Should be called outside of begin() / end()
+    // Only changes drawQuad / drawQuads, StaticBatch keeps using QuadVert
+    static void setVertexFormat(VertexFormat format) {
+        if (FramePacket* packet = recording_packet()) {
+            packet->call([format] { setVertexFormat(format); });
+            return;
+        }
+        sceneData->vertexFormat = format;
+    }
+
+    // Only used in SubmitMode::Sorted, higher layers are drawn on top
+    // (this is per thread when drawing from worker threads)
+    static void setLayer(uint8_t layer) {
+        if (FramePacket* packet = recording_packet()) {
+            packet->call([layer] { setLayer(layer); });
+            return;
+        }
+        if (QuadArena* arena = worker_arena()) {
+            arena->currentLayer = layer;
+            return;
+        }
+        sceneData->currentLayer = layer;
+    }
+
+    // Returns the calling threads arena, or nullptr on the recording thread
+    //
+    // You can call drawQuad / drawQuads / drawSprite from worker threads
+    // between begin() and end() (lines and polygons are still main thread
+    // only). Arenas are merged in the order the threads first drew, after
+    // anything drawn on the main thread, so use SubmitMode::Sorted if the
+    // order between threads matters. With a RenderThread running, end()
+    // moves them into the packet on the main thread, so the workers have
+    // to be done before it either way
+    static QuadArena* worker_arena() {
+        thread_local WorkerArenaSlot slot;
+        const uint32_t generation = arenaGeneration.load();
+        if (slot.generation != generation) {
+            slot.arena = nullptr;
+            slot.generation = generation;
+        }
+        if (slot.arena) return slot.arena;
+        // not cached, the recording thread moves when a RenderThread
+        // starts or stops
+        if (std::this_thread::get_id() == sceneData->recordingThread.load()) {
+            return nullptr;
+        }
+
+        std::lock_guard<std::mutex> lock(sceneData->arenaMutex);
+        sceneData->arenas.push_back(std::make_unique<QuadArena>());
+        slot.arena = sceneData->arenas.back().get();
+        return slot.arena;
+    }
+
+    // The thread might have drawn right before it exited (draw then join
+    // before end() is the usual way) so the arena stays until its merged
+    static void release_worker_arena(WorkerArenaSlot& slot) {
+        if (!slot.arena || !sceneData ||
+            slot.generation != arenaGeneration.load()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(sceneData->arenaMutex);
+        slot.arena->orphaned = true;
+        slot.arena = nullptr;
+    }
+
+    // Non null on the main thread while a RenderThread is running, draws
+    // and state changes go in here instead of to the gpu
+    static FramePacket*& recording_packet() {
+        thread_local FramePacket* packet = nullptr;
+        return packet;
+    }
+
+    // Runs fn on whichever thread has the gl context, so right away unless
+    // a RenderThread is running. Anything that calls gl directly (loading
+    // textures, glText...) from Layer::onRender should go through here
+    static void enqueue(std::function<void()> fn) {
+        if (FramePacket* packet = recording_packet()) {
+            packet->call(std::move(fn));
+            return;
+        }
+        fn();
+    }
+
+    // Render thread only, makes every call that was recorded into packet
+    static void replay(const FramePacket& packet) {
+        prof give_me_a_name(__PROFILE_FUNC__);
+        sceneData->replaying = &packet;
+        stats.culledQuads += packet.culledQuads;
+        for (const FramePacket::Command& command : packet.commands) {
+            if (command.call) {
+                command.call();
+                continue;
+            }
+            for (size_t i = command.firstQuad;
+                 i < command.firstQuad + command.numQuads; i++) {
+                const SortedQuad& quad = packet.quads[i];
+                submit_quad(quad.positions, quad.color, quad.texture,
+                            quad.texcoords, packet.depths[i]);
+            }
+        }
+        sceneData->replaying = nullptr;
+    }
+
+    // The texture behind a handle for the batches, null if there isnt one
+    // (invalid or evicted). During replay() this comes from the packet so
+    // the render thread never reads the TextureLibrary
+    static const std::shared_ptr<Texture>& resolve_texture(
+        TextureHandle texture) {
+        static const std::shared_ptr<Texture> none;
+        const uint32_t id = texture.id;
+        if (const FramePacket* packet = sceneData->replaying) {
+            return id < packet->textures.size() &&
+                           packet->generations[id] == texture.generation
+                       ? packet->textures[id]
+                       : none;
+        }
+        return TextureLibrary::get().resolve(texture);
+    }
+
+    // For culling done outside the Renderer (like Entity), stats belong to
+    // whichever thread is rendering
+    static void noteCulled(int count = 1) {
+        if (FramePacket* packet = recording_packet()) {
+            packet->culledQuads += count;
+            return;
+        }
+        stats.culledQuads += count;
+    }
+
+    static void record_arena_quad(QuadArena* arena,
+                                  const std::array<glm::vec3, 4>& positions,
+                                  const glm::vec4& color,
+                                  const std::array<glm::vec2, 4>& texcoords,
+                                  TextureHandle texture, float depth) {
+        // the submit mode belongs to whoever runs end(), so the key is
+        // always made and only used if that ends up sorted. Workers cant
+        // read the library, merge_quads fills in the shader
+        arena->sortKeys.push_back(
+            makeSortKey(arena->currentLayer, depth, 0, texture.id));
+        arena->quads.push_back(
+            SortedQuad{positions, color, texcoords, texture});
+    }
+
+    // Worker quads into the batches (or the sort) on the recording thread
+    static void merge_quads(const SortedQuad* quads, const uint64_t* sortKeys,
+                            size_t count) {
+        if (sceneData->submitMode == SubmitMode::Sorted) {
+            for (size_t i = 0; i < count; i++) {
+                sceneData->sortKeys.push_back(
+                    sortKeys[i] |
+                    ((uint64_t)quad_shader(quads[i].texture) << 32));
+            }
+            sceneData->sortedQuads.insert(sceneData->sortedQuads.end(),
+                                          quads, quads + count);
+            return;
+        }
+        for (size_t i = 0; i < count; i++) {
+            batch_quad(quads[i].positions.data(), quads[i].color,
+                       quads[i].texcoords, quads[i].texture);
+        }
+    }
+
+    // Runs on the recording thread, the arena vectors keep their capacity
+    // so after the first few frames workers dont allocate at all
+    static void merge_worker_arenas() {
+        prof give_me_a_name(__PROFILE_FUNC__);
+        std::lock_guard<std::mutex> lock(sceneData->arenaMutex);
+        for (auto& arena : sceneData->arenas) {
+            merge_quads(arena->quads.data(), arena->sortKeys.data(),
+                        arena->quads.size());
+            stats.culledQuads += arena->culledQuads;
+            arena->culledQuads = 0;
+            arena->quads.clear();
+            arena->sortKeys.clear();
+        }
+        std::erase_if(sceneData->arenas,
+                      [](const auto& arena) { return arena->orphaned; });
+    }
+
+    // Same as merge_worker_arenas but into the packet, on the main thread
+    // while a RenderThread is running. Textures are pinned here since the
+    // library belongs to this thread
+    static void drain_worker_arenas(FramePacket& packet) {
+        prof give_me_a_name(__PROFILE_FUNC__);
+        std::lock_guard<std::mutex> lock(sceneData->arenaMutex);
+        for (auto& arena : sceneData->arenas) {
+            for (const SortedQuad& quad : arena->quads) {
+                packet.pin(quad.texture);
+            }
+            packet.workerQuads.insert(packet.workerQuads.end(),
+                                      arena->quads.begin(),
+                                      arena->quads.end());
+            packet.workerSortKeys.insert(packet.workerSortKeys.end(),
+                                         arena->sortKeys.begin(),
+                                         arena->sortKeys.end());
+            packet.culledQuads += arena->culledQuads;
+            arena->culledQuads = 0;
+            arena->quads.clear();
+            arena->sortKeys.clear();
+        }
+        std::erase_if(sceneData->arenas,
+                      [](const auto& arena) { return arena->orphaned; });
+    }
+
+    // Which of the quad shaders the texture is drawn with, array layers go
+    // through texture_array.glsl. Sorting on it keeps them together so
+    // batch_quad doesnt flush back and forth between the two
+    enum QuadShader : uint8_t {
+        QUAD_SHADER_TEXTURE = 0,
+        QUAD_SHADER_ARRAY = 1,
+    };
+
+    static uint8_t quad_shader(TextureHandle texture) {
+        const Texture* tex = resolve_texture(texture).get();
+        return tex && tex->arrayLayer >= 0 ? QUAD_SHADER_ARRAY
+                                           : QUAD_SHADER_TEXTURE;
+    }
+
+    // layer | depth | shader | texture
+    //   8   |  16   |   8    |   32
+    static uint64_t makeSortKey(uint8_t layer, float depth, uint8_t shader,
+                                uint32_t texture) {
+        // ortho cameras use a -1 to 1 depth range
+        float d = (fmin(fmax(depth, -1.f), 1.f) * 0.5f) + 0.5f;
+        uint64_t depthBits = (uint64_t)(d * 0xffff);
+        return ((uint64_t)layer << 56) | (depthBits << 40) |
+               ((uint64_t)shader << 32) | (uint64_t)texture;
+    }
+
+    static void record_sorted_quad(const std::array<glm::vec3, 4>& positions,
+                                   const glm::vec4& color,
+                                   const std::array<glm::vec2, 4>& texcoords,
+                                   TextureHandle texture, float depth) {
+        sceneData->sortKeys.push_back(
+            makeSortKey(sceneData->currentLayer, depth, quad_shader(texture),
+                        texture.id));
+        sceneData->sortedQuads.push_back(
+            SortedQuad{positions, color, texcoords, texture});
+    }
+
+    static void flush_sorted() {
+        prof give_me_a_name(__PROFILE_FUNC__);
+        radix_sort_indices(sceneData->sortKeys, sceneData->sortIndices,
+                           sceneData->sortScratch);
+
+        for (uint32_t index : sceneData->sortIndices) {
+            const SortedQuad& quad = sceneData->sortedQuads[index];
+            batch_quad(quad.positions.data(), quad.color, quad.texcoords,
+                       quad.texture);
+        }
+
+        sceneData->sortedQuads.clear();
+        sceneData->sortKeys.clear();
+    }
+
+    static void* map_stream_buffer(
+        const std::shared_ptr<StreamingVertexBuffer>& buffer) {
+        const StreamingVertexBuffer::Stats before = buffer->stats;
+        void* ptr = buffer->map();
+        stats.bufferStalls += buffer->stats.stalls - before.stalls;
+        stats.bufferStallTime += buffer->stats.stallTime - before.stallTime;
+        stats.bufferOverflows += buffer->stats.overflows - before.overflows;
+        return ptr;
+    }
+
+    // Buffers only get mapped once something is written to them, so a
+    // batch without lines doesnt take up (or wait on) the line buffer
+    //
+    // Call it after anything that can next_batch() (texture_slot etc)
+    template <typename T>
+    static void ensure_mapped(
+        const std::shared_ptr<StreamingVertexBuffer>& buffer, T*& start,
+        T*& ptr) {
+        if (start) return;
+        start = (T*)map_stream_buffer(buffer);
+        ptr = start;
+    }
+
+    // returns how many bytes were written, 0 if it was never mapped
+    template <typename T>
+    static int unmap_stream_buffer(
+        const std::shared_ptr<StreamingVertexBuffer>& buffer, T*& start,
+        T*& ptr) {
+        if (!start) return 0;
+        int bytes = (int)((uint8_t*)ptr - (uint8_t*)start);
+        buffer->unmap(bytes);
+        start = nullptr;
+        ptr = nullptr;
+        return bytes;
+    }
+
     static void start_batch() {
-        sceneData->textureSlots[0] =
-            dynamic_pointer_cast<Texture2D>(TextureLibrary::get().get("white"));
+        sceneData->textureSlots[0] = sceneData->white;
+        // invalidates every entry in handleSlot
+        sceneData->batchID++;
 
         sceneData->quadIndexCount = 0;
-        sceneData->qvbufferptr = sceneData->qvbufferstart;
         sceneData->nextTexSlot = 1;
+        sceneData->atlasImagesInBatch = 0;
 
+        sceneData->arrayIndexCount = 0;
+        sceneData->nextArraySlot = 0;
+
+        sceneData->spriteCount = 0;
         sceneData->lineVertexCount = 0;
-        sceneData->lvbufferptr = sceneData->lvbufferstart;
 
         sceneData->polyVertexCount = 0;
-        sceneData->pvbufferptr = sceneData->pvbufferstart;
+        sceneData->polyIndices.clear();
     }
 
     static void next_batch() {
@@ -380,37 +1221,83 @@ struct Renderer {
         start_batch();
     }
 
+    // The vertices were written straight into the streaming buffers,
+    // so all thats left is to unmap them and draw
     static void flush() {
-        if (sceneData->quadIndexCount) {
-            uint32_t dataSize = (uint32_t)((uint8_t*)sceneData->qvbufferptr -
-                                           (uint8_t*)sceneData->qvbufferstart);
-            sceneData->quadVB->setData(sceneData->qvbufferstart, dataSize);
-
+        const bool compact = sceneData->vertexFormat == VertexFormat::Compact;
+        stats.quadVertexBytes +=
+            unmap_stream_buffer(sceneData->quadVB, sceneData->qvbufferstart,
+                                sceneData->qvbufferptr) +
+            unmap_stream_buffer(sceneData->compactQuadVB,
+                                sceneData->cqvbufferstart,
+                                sceneData->cqvbufferptr);
+        unmap_stream_buffer(sceneData->arrayQuadVB, sceneData->aqvbufferstart,
+                            sceneData->aqvbufferptr);
+        unmap_stream_buffer(sceneData->spriteVB, sceneData->sibufferstart,
+                            sceneData->sibufferptr);
+        unmap_stream_buffer(sceneData->lineVB, sceneData->lvbufferstart,
+                            sceneData->lvbufferptr);
+        unmap_stream_buffer(sceneData->polyVB, sceneData->pvbufferstart,
+                            sceneData->pvbufferptr);
+
+        // quads and sprites share the texture slots
+        if (sceneData->quadIndexCount || sceneData->spriteCount) {
+            int atlasPages = 0;
             for (int i = 0; i < sceneData->nextTexSlot; i++) {
                 sceneData->textureSlots[i]->bind(i);
+                if (sceneData->textureSlots[i]->atlasPage) atlasPages++;
+            }
+            stats.atlasSlotsSaved +=
+                std::max(0, sceneData->atlasImagesInBatch - atlasPages);
+        }
+
+        if (sceneData->quadIndexCount) {
+            if (compact) {
+                sceneData->textureCompactShader->bind();
+                draw_INTERNAL(sceneData->compactQuadVA,
+                              sceneData->quadIndexCount,
+                              sceneData->compactQuadVB->baseVertex());
+            } else {
+                sceneData->textureShader->bind();
+                draw_INTERNAL(sceneData->quadVA, sceneData->quadIndexCount,
+                              sceneData->quadVB->baseVertex());
             }
+            stats.drawCalls++;
+        }
 
-            sceneData->shaderLibrary.get("texture")->bind();
+        if (sceneData->arrayIndexCount) {
+            for (int i = 0; i < sceneData->nextArraySlot; i++) {
+                sceneData->arraySlots[i]->bind(i);
+            }
+            sceneData->textureArrayShader->bind();
+            draw_INTERNAL(sceneData->arrayQuadVA, sceneData->arrayIndexCount,
+                          sceneData->arrayQuadVB->baseVertex());
+            stats.drawCalls++;
+        }
 
-            draw_INTERNAL(sceneData->quadVA, sceneData->quadIndexCount);
+        if (sceneData->spriteCount) {
+            // instances live wherever spriteVB put this batch
+            sceneData->spriteVA->setBufferOffset(
+                1, sceneData->spriteVB->mapOffset);
+            sceneData->spriteShader->bind();
+            drawSprites_INTERNAL(sceneData->spriteVA, sceneData->spriteCount);
             stats.drawCalls++;
         }
 
         if (sceneData->lineVertexCount) {
-            uint32_t dataSize = (uint32_t)((uint8_t*)sceneData->lvbufferptr -
-                                           (uint8_t*)sceneData->lvbufferstart);
-            sceneData->lineVB->setData(sceneData->lvbufferstart, dataSize);
-            sceneData->shaderLibrary.get("line")->bind();
-            drawLines_INTERNAL(sceneData->lineVA, sceneData->lineVertexCount);
+            sceneData->lineShader->bind();
+            drawLines_INTERNAL(sceneData->lineVA, sceneData->lineVertexCount,
+                               sceneData->lineVB->baseVertex());
             stats.drawCalls++;
         }
 
-        if (sceneData->polyVertexCount) {
-            uint32_t dataSize = (uint32_t)((uint8_t*)sceneData->pvbufferptr -
-                                           (uint8_t*)sceneData->pvbufferstart);
-            sceneData->polyVB->setData(sceneData->pvbufferstart, dataSize);
-            sceneData->shaderLibrary.get("poly")->bind();
-            drawPoly_INTERNAL(sceneData->polyVA, sceneData->polyVertexCount);
+        if (!sceneData->polyIndices.empty()) {
+            int polyIndexCount = (int)sceneData->polyIndices.size();
+            sceneData->polyIB->setData(sceneData->polyIndices.data(),
+                                       polyIndexCount);
+            sceneData->polyShader->bind();
+            drawPoly_INTERNAL(sceneData->polyVA, polyIndexCount,
+                              sceneData->polyVB->baseVertex());
             stats.drawCalls++;
         }
 
@@ -419,6 +1306,65 @@ struct Renderer {
 
     static void drawQuad(const glm::mat4& transform, const glm::vec4& color,
                          const std::string& textureName = DEFAULT_TEX) {
+        // If you are drawing a lot of quads, resolve the name once with
+        // TextureLibrary::getHandle() and use the handle versions instead
+        const TextureLibrary& library = TextureLibrary::get();
+
+        auto textureIt = library.textures.find(textureName);
+        if (textureIt != library.textures.end() && textureIt->second) {
+            drawQuad(transform, color, textureIt->second->handle);
+            return;
+        }
+
+        auto subtextureIt = library.subtextures.find(textureName);
+        if (subtextureIt != library.subtextures.end() &&
+            subtextureIt->second) {
+            drawQuad(transform, color, subtextureIt->second->handle);
+            return;
+        }
+
+        // textureName didnt exist at all, so use the default
+        drawQuad(transform, color, TextureHandle());
+    }
+
+    static void drawQuad(const glm::mat4& transform, const glm::vec4& color,
+                         TextureHandle textureHandle) {
+        Texture* texture = TextureLibrary::get().get(textureHandle);
+        if (!texture) {
+            // either the handle was invalid or the texture was evicted
+            textureHandle = sceneData->whiteTexture;
+            texture = TextureLibrary::get().get(textureHandle);
+        }
+        if (texture->temporary) touch_cached(texture);
+        drawQuad_INTERNAL(transform, color, textureHandle,
+                          texture->textureCoords);
+    }
+
+    static void drawQuad(const glm::mat4& transform, const glm::vec4& color,
+                         SubtextureHandle subtextureHandle) {
+        const Subtexture* subtexture =
+            TextureLibrary::get().getSubtexture(subtextureHandle);
+        if (!subtexture || !subtexture->texture ||
+            !TextureLibrary::get().get(subtexture->texture->handle)) {
+            drawQuad(transform, color, TextureHandle());
+            return;
+        }
+        drawQuad_INTERNAL(transform, color, subtexture->texture->handle,
+                          subtexture->textureCoords);
+        note_atlas_image(subtexture);
+    }
+
+    // the texture cache isnt thread safe, so only the thread that owns
+    // the library (main) keeps it up to date
+    static void touch_cached(Texture* texture) {
+        if (!recording_packet() && worker_arena()) return;
+        TextureLibrary::get().touch(texture);
+    }
+
+    static void drawQuad_INTERNAL(const glm::mat4& transform,
+                                  const glm::vec4& color,
+                                  TextureHandle texture,
+                                  const std::array<glm::vec2, 4>& texcoords) {
         const std::array<glm::vec4, 4> vertexCoords = {{
             {-0.5f, -0.5f, 0.0f, 1.0f},
             {0.5f, -0.5f, 0.0f, 1.0f},
@@ -426,64 +1372,246 @@ struct Renderer {
             {-0.5f, 0.5f, 0.0f, 1.0f},
         }};
 
-        if (sceneData->quadIndexCount >= sceneData->MAX_IND) {
-            next_batch();
+        std::array<glm::vec3, 4> positions;
+        for (size_t i = 0; i < 4; i++) {
+            positions[i] = transform * vertexCoords[i];
         }
+        submit_quad(positions, color, texture, texcoords, transform[3].z);
+    }
 
-        auto textureStatus =
-            TextureLibrary::get().isTextureOrSubtexture(textureName);
+    // Everything after the corners are known, shared by drawQuad and the
+    // thick line path
+    static void submit_quad(const std::array<glm::vec3, 4>& positions,
+                            const glm::vec4& color, TextureHandle texture,
+                            const std::array<glm::vec2, 4>& texcoords,
+                            float depth) {
+        if (FramePacket* packet = recording_packet()) {
+            packet->quad(positions, color, texcoords, texture, depth);
+            return;
+        }
+        QuadArena* arena = worker_arena();
+        if (cull_quad(positions.data(), arena)) return;
 
-        std::shared_ptr<Texture> texture;
-        std::shared_ptr<Subtexture> subtexture;
+        if (arena) {
+            record_arena_quad(arena, positions, color, texcoords, texture,
+                              depth);
+            return;
+        }
 
-        if (textureStatus == -1 || textureStatus == 0) {
-            texture = TextureLibrary::get_tex(textureName);
-        } else {
-            subtexture = TextureLibrary::get().getSubtexture(textureName);
-            // only do this -> when valid, to avoid segfault
-            // we check for validity later so this is fine
-            if (subtexture) texture = subtexture->texture;
-        }
-
-        // Load the corresponding Texture into the texture slots
-        float textureIndex = 0.f;
-        if (texture                        // tex is valid (ie not nullptr)
-            && textureName != DEFAULT_TEX  // default tex is always loaded
-            && textureStatus != -1  // set to default tex so already loaded
-        ) {
-            for (int i = 1; i < sceneData->nextTexSlot; i++) {
-                if (*(sceneData->textureSlots[i]) == *texture) {
-                    textureIndex = (float)i;
-                    break;
+        if (sceneData->submitMode == SubmitMode::Sorted) {
+            record_sorted_quad(positions, color, texcoords, texture, depth);
+            return;
+        }
+
+        batch_quad(positions.data(), color, texcoords, texture);
+    }
+
+    // Bulk version of drawQuad for when you have a lot of quads at once
+    // (tilemaps, particles). The corners are built a chunk at a time
+    // (see quadtransform.h) and written straight into the batch
+    static void drawQuads(std::span<const SpriteDesc> sprites) {
+        prof give_me_a_name(__PROFILE_FUNC__);
+
+        constexpr size_t CHUNK = 64;
+        std::array<glm::vec3, CHUNK * 4> corners;
+
+        const TextureLibrary& library = TextureLibrary::get();
+        const Texture* white = library.get(sceneData->whiteTexture);
+        FramePacket* packet = recording_packet();
+        QuadArena* arena = packet ? nullptr : worker_arena();
+
+        for (size_t start = 0; start < sprites.size(); start += CHUNK) {
+            size_t count = std::min(CHUNK, sprites.size() - start);
+            const SpriteDesc* chunk = sprites.data() + start;
+            transform_sprite_corners(chunk, count, corners.data());
+
+            for (size_t i = 0; i < count; i++) {
+                const SpriteDesc& sprite = chunk[i];
+                const glm::vec3* positions = corners.data() + (i * 4);
+                if (!packet && cull_quad(positions, arena)) continue;
+
+                TextureHandle texture = sceneData->whiteTexture;
+                const std::array<glm::vec2, 4>* texcoords =
+                    &white->textureCoords;
+                const Subtexture* subtexture =
+                    sprite.subtexture.valid()
+                        ? library.getSubtexture(sprite.subtexture)
+                        : nullptr;
+                Texture* used = nullptr;
+                if (subtexture && subtexture->texture &&
+                    (used = library.get(subtexture->texture->handle))) {
+                    texture = subtexture->texture->handle;
+                    texcoords = &subtexture->textureCoords;
+                } else if ((used = library.get(sprite.texture))) {
+                    texture = sprite.texture;
+                    texcoords = &used->textureCoords;
                 }
-            }
-            if (textureIndex == 0) {
-                if (sceneData->nextTexSlot >= MAX_TEX) {
-                    next_batch();
+                // same as drawQuad, otherwise text drawn through here
+                // looks unused and gets evicted while on screen
+                if (used && used->temporary) touch_cached(used);
+
+                if (packet) {
+                    packet->quad({positions[0], positions[1], positions[2],
+                                  positions[3]},
+                                 sprite.color, *texcoords, texture,
+                                 sprite.position.z);
+                    continue;
+                }
+                if (arena) {
+                    record_arena_quad(arena,
+                                      {positions[0], positions[1],
+                                       positions[2], positions[3]},
+                                      sprite.color, *texcoords, texture,
+                                      sprite.position.z);
+                    continue;
+                }
+                if (sceneData->submitMode == SubmitMode::Sorted) {
+                    record_sorted_quad(
+                        {positions[0], positions[1], positions[2],
+                         positions[3]},
+                        sprite.color, *texcoords, texture, sprite.position.z);
+                    continue;
                 }
-                textureIndex = sceneData->nextTexSlot;
-                sceneData->textureSlots[textureIndex] =
-                    dynamic_pointer_cast<Texture2D>(texture);
-                sceneData->nextTexSlot++;
 
-                stats.textureCount++;
+                batch_quad(positions, sprite.color, *texcoords, texture);
+                if (subtexture) note_atlas_image(subtexture);
             }
-        } else {
-            texture = TextureLibrary::get_tex(DEFAULT_TEX);
-            // if we fall into this case,
-            // either textureName didnt exist at all
-            // or textureName was a texture and is invalid
-            // or textureName was an invalid subtexture or texture is
-            textureStatus = -1;
         }
-        // else use 0 which is white texture
+    }
 
+    // Only feeds stats.atlasSlotsSaved, in Sorted mode this counts per
+    // frame instead of per batch so its an overestimate there
+    static void note_atlas_image(const Subtexture* subtexture) {
+        if (subtexture->atlasImage < 0 || recording_packet() ||
+            worker_arena()) {
+            return;
+        }
+        size_t id = (size_t)subtexture->atlasImage;
+        if (id >= sceneData->atlasImageBatch.size()) {
+            sceneData->atlasImageBatch.resize(id + 1, 0);
+        }
+        if (sceneData->atlasImageBatch[id] == sceneData->batchID) return;
+        sceneData->atlasImageBatch[id] = sceneData->batchID;
+        sceneData->atlasImagesInBatch++;
+    }
+
+    // Writes the quad into whichever batch its texture belongs to,
+    // flushing first if that batch is full
+    //
+    // Array quads are drawn after the normal ones in flush(), so switching
+    // between the two flushes too, otherwise overlapping quads would come
+    // out in a different order than they were drawn. Draw array textures
+    // together (SubmitMode::Sorted does that for you) to not pay for that
+    static void batch_quad(const glm::vec3* positions, const glm::vec4& color,
+                           const std::array<glm::vec2, 4>& texcoords,
+                           TextureHandle texture) {
+        const Texture* tex = resolve_texture(texture).get();
+        if (tex && tex->arrayLayer >= 0) {
+            if (sceneData->quadIndexCount) next_batch();
+            write_array_quad(positions, color, texcoords,
+                             *static_cast<const TextureArrayLayer*>(tex));
+            return;
+        }
+
+        if (sceneData->quadIndexCount >= sceneData->MAX_IND ||
+            sceneData->arrayIndexCount) {
+            next_batch();
+        }
+        float textureIndex = texture_slot(texture);
+        write_quad(positions, color, texcoords, textureIndex);
+    }
+
+    // Same idea as texture_slot but there are only a few arrays per batch
+    // so a linear search is fine
+    static float array_slot(const std::shared_ptr<Texture2DArray>& array) {
+        for (int i = 0; i < sceneData->nextArraySlot; i++) {
+            if (sceneData->arraySlots[i] == array) return (float)i;
+        }
+        if (sceneData->nextArraySlot >= MAX_ARRAY_TEX) {
+            next_batch();
+        }
+        int slot = sceneData->nextArraySlot++;
+        sceneData->arraySlots[slot] = array;
+        stats.textureCount++;
+        return (float)slot;
+    }
+
+    static void write_array_quad(const glm::vec3* positions,
+                                 const glm::vec4& color,
+                                 const std::array<glm::vec2, 4>& texcoords,
+                                 const TextureArrayLayer& layer) {
+        if (sceneData->arrayIndexCount >= sceneData->MAX_IND) {
+            next_batch();
+        }
+        float arrayIndex = array_slot(layer.array);
+        ensure_mapped(sceneData->arrayQuadVB, sceneData->aqvbufferstart,
+                      sceneData->aqvbufferptr);
         for (size_t i = 0; i < 4; i++) {
-            sceneData->qvbufferptr->position = transform * vertexCoords[i];
+            sceneData->aqvbufferptr->position = positions[i];
+            sceneData->aqvbufferptr->color = color;
+            sceneData->aqvbufferptr->texcoord = texcoords[i];
+            sceneData->aqvbufferptr->layer = (float)layer.arrayLayer;
+            sceneData->aqvbufferptr->arrayindex = arrayIndex;
+            sceneData->aqvbufferptr++;
+        }
+        sceneData->arrayIndexCount += 6;
+
+        stats.quadCount++;
+    }
+
+    // Returns the slot this texture is bound to for the current batch,
+    // if its not bound yet, takes the next open slot (flushing if needed)
+    //
+    // The white texture is always in slot 0
+    static float texture_slot(TextureHandle texture) {
+        if (texture == sceneData->whiteTexture || !texture.valid()) return 0.f;
+
+        // evicted between the draw and now (sorted mode and worker arenas
+        // get here later), draw it white instead. This goes first so a
+        // stale handle never finds the slot of whatever reused its id
+        const std::shared_ptr<Texture>& resolved = resolve_texture(texture);
+        if (!resolved) return 0.f;
+
+        const uint32_t id = texture.id;
+        if (id >= sceneData->handleSlot.size()) {
+            // only happens after new textures are added to the library
+            sceneData->handleSlot.resize(id + 1, 0);
+            sceneData->handleSlotBatch.resize(id + 1, 0);
+        }
+
+        if (sceneData->handleSlotBatch[id] == sceneData->batchID) {
+            return (float)sceneData->handleSlot[id];
+        }
+
+        if (sceneData->nextTexSlot >= MAX_TEX) {
+            next_batch();
+        }
+        int textureIndex = sceneData->nextTexSlot;
+        // Only refcount traffic is here, once per texture per batch
+        sceneData->textureSlots[textureIndex] = resolved;
+        sceneData->nextTexSlot++;
+        sceneData->handleSlot[id] = textureIndex;
+        sceneData->handleSlotBatch[id] = sceneData->batchID;
+
+        stats.textureCount++;
+        return (float)textureIndex;
+    }
+
+    // positions has to point at 4 corners
+    static void write_quad(const glm::vec3* positions,
+                           const glm::vec4& color,
+                           const std::array<glm::vec2, 4>& texcoords,
+                           float textureIndex) {
+        if (sceneData->vertexFormat == VertexFormat::Compact) {
+            write_compact_quad(positions, color, texcoords, textureIndex);
+            return;
+        }
+        ensure_mapped(sceneData->quadVB, sceneData->qvbufferstart,
+                      sceneData->qvbufferptr);
+        for (size_t i = 0; i < 4; i++) {
+            sceneData->qvbufferptr->position = positions[i];
             sceneData->qvbufferptr->color = color;
-            sceneData->qvbufferptr->texcoord =
-                textureStatus != 1 ? texture->textureCoords[i]
-                                   : subtexture->textureCoords[i];
+            sceneData->qvbufferptr->texcoord = texcoords[i];
             sceneData->qvbufferptr->texindex = textureIndex;
             sceneData->qvbufferptr++;
         }
@@ -492,6 +1620,138 @@ struct Renderer {
         stats.quadCount++;
     }
 
+    static void write_compact_quad(const glm::vec3* positions,
+                                   const glm::vec4& color,
+                                   const std::array<glm::vec2, 4>& texcoords,
+                                   float textureIndex) {
+        const uint32_t packedColor = pack_unorm8x4(color);
+        const uint8_t slot = (uint8_t)textureIndex;
+        ensure_mapped(sceneData->compactQuadVB, sceneData->cqvbufferstart,
+                      sceneData->cqvbufferptr);
+        for (size_t i = 0; i < 4; i++) {
+            CompactQuadVert* v = sceneData->cqvbufferptr;
+            v->position = glm::vec2{positions[i].x, positions[i].y};
+            v->color = packedColor;
+            v->texcoord[0] = pack_unorm16(texcoords[i].x);
+            v->texcoord[1] = pack_unorm16(texcoords[i].y);
+            v->texindex[0] = slot;
+            v->texindex[1] = 0;
+            v->texindex[2] = 0;
+            v->texindex[3] = 0;
+            sceneData->cqvbufferptr++;
+        }
+        sceneData->quadIndexCount += 6;
+
+        stats.quadCount++;
+    }
+
+    // Instanced version of drawQuad, the quad is built in the vertex shader
+    // so we only write one SpriteInstance instead of four QuadVerts
+    //
+    // Note: sprites are drawn after the quads in the same batch, so if you
+    // need a sprite under a quad use Sorted mode (where sprites go through
+    // the regular sorted quad path) or a separate begin()/end()
+    static void drawSprite(const glm::vec3& position, const glm::vec2& size,
+                           float angleInRad, const glm::vec4& color,
+                           TextureHandle textureHandle) {
+        Texture* texture = TextureLibrary::get().get(textureHandle);
+        if (!texture) {
+            textureHandle = sceneData->whiteTexture;
+            texture = TextureLibrary::get().get(textureHandle);
+        }
+        if (texture->temporary) touch_cached(texture);
+        drawSprite_INTERNAL(position, size, angleInRad, color, textureHandle,
+                            texture->textureCoords);
+    }
+
+    static void drawSprite(const glm::vec3& position, const glm::vec2& size,
+                           float angleInRad, const glm::vec4& color,
+                           SubtextureHandle subtextureHandle) {
+        const Subtexture* subtexture =
+            TextureLibrary::get().getSubtexture(subtextureHandle);
+        if (!subtexture || !subtexture->texture ||
+            !TextureLibrary::get().get(subtexture->texture->handle)) {
+            drawSprite(position, size, angleInRad, color, TextureHandle());
+            return;
+        }
+        drawSprite_INTERNAL(position, size, angleInRad, color,
+                            subtexture->texture->handle,
+                            subtexture->textureCoords);
+        note_atlas_image(subtexture);
+    }
+
+    static void drawSprite(const glm::vec3& position, const glm::vec2& size,
+                           float angleInRad, const glm::vec4& color,
+                           const std::string& textureName = DEFAULT_TEX) {
+        const TextureLibrary& library = TextureLibrary::get();
+
+        auto textureIt = library.textures.find(textureName);
+        if (textureIt != library.textures.end() && textureIt->second) {
+            drawSprite(position, size, angleInRad, color,
+                       textureIt->second->handle);
+            return;
+        }
+
+        auto subtextureIt = library.subtextures.find(textureName);
+        if (subtextureIt != library.subtextures.end() &&
+            subtextureIt->second) {
+            drawSprite(position, size, angleInRad, color,
+                       subtextureIt->second->handle);
+            return;
+        }
+
+        drawSprite(position, size, angleInRad, color, TextureHandle());
+    }
+
+    static void drawSprite_INTERNAL(const glm::vec3& position,
+                                    const glm::vec2& size, float angleInRad,
+                                    const glm::vec4& color,
+                                    TextureHandle texture,
+                                    const std::array<glm::vec2, 4>& texcoords) {
+        // the instance buffer is main thread only (render thread only
+        // while recording), and the sprite shader only has sampler2Ds
+        const Texture* tex = TextureLibrary::get().get(texture);
+        if (recording_packet() ||
+            sceneData->submitMode == SubmitMode::Sorted || worker_arena() ||
+            (tex && tex->arrayLayer >= 0)) {
+            auto transform =
+                glm::translate(imat, position) *
+                glm::rotate(imat, angleInRad, {0.0f, 0.0f, 1.f}) *
+                glm::scale(imat, {size.x, size.y, 1.0f});
+            drawQuad_INTERNAL(transform, color, texture, texcoords);
+            return;
+        }
+
+        // rotated or not, the sprite fits in a circle this big
+        float radius = 0.5f * sqrtf(size.x * size.x + size.y * size.y);
+        if (!isVisible(glm::vec2{position.x - radius, position.y - radius},
+                       glm::vec2{position.x + radius, position.y + radius})) {
+            stats.culledQuads++;
+            return;
+        }
+
+        if (sceneData->spriteCount >= sceneData->MAX_SPRITES) {
+            next_batch();
+        }
+
+        float textureIndex = texture_slot(texture);
+        ensure_mapped(sceneData->spriteVB, sceneData->sibufferstart,
+                      sceneData->sibufferptr);
+
+        SpriteInstance* instance = sceneData->sibufferptr;
+        instance->position = position;
+        instance->size = size;
+        instance->rotation = angleInRad;
+        instance->color = color;
+        instance->uvRect = glm::vec4{texcoords[0].x, texcoords[0].y,
+                                     texcoords[2].x, texcoords[2].y};
+        instance->texindex = textureIndex;
+        sceneData->sibufferptr++;
+        sceneData->spriteCount++;
+
+        stats.quadCount++;
+    }
+
     // for (int i = 0; i < 360; i += 10) {
     // Renderer::drawLine(glm::vec3{0.f, 0.f, 0.f},
     // glm::vec2{
@@ -500,8 +1760,29 @@ struct Renderer {
     // },
     // glm::vec4{1, 1, 1, 1});
     // }
+    //
+    // Lines thicker than a pixel (see setLineThickness) are drawn as quads
+    // when we know how big a pixel is, glLineWidth over 1 isnt supported
+    // in core profiles and it costs a state change per thickness anyway
     static void drawLine(const glm::vec3& start, const glm::vec3& end,
                          const glm::vec4& color) {
+        if (FramePacket* packet = recording_packet()) {
+            // thickness is only known on the render thread
+            packet->call([start, end, color] { drawLine(start, end, color); });
+            return;
+        }
+        if (sceneData->lineThickness > 1.f && sceneData->worldPerPixel > 0.f) {
+            drawLine(start, end, color,
+                     sceneData->lineThickness * sceneData->worldPerPixel);
+            return;
+        }
+
+        if (sceneData->lineVertexCount + 2 > sceneData->MAX_VERTS) {
+            next_batch();
+        }
+        ensure_mapped(sceneData->lineVB, sceneData->lvbufferstart,
+                      sceneData->lvbufferptr);
+
         sceneData->lvbufferptr->position = start;
         sceneData->lvbufferptr->color = color;
         sceneData->lvbufferptr++;
@@ -513,23 +1794,95 @@ struct Renderer {
         sceneData->lineVertexCount += 2;
     }
 
-    static void drawPolygon(const std::vector<glm::vec2> points,
-                            const glm::vec4& color) {
-        if (points.empty()) return;
+    // Filled polygon, points in order around the outside (either winding)
+    //
+    // Polygons are triangulated into the poly batch so any number of them
+    // go out in one draw call. If you know its convex (like a
+    // Polygon::hull) pass convex = true to skip the ear clipping
+    static void drawPolygon(const std::vector<glm::vec2>& points,
+                            const glm::vec4& color, bool convex = false) {
+        const int numPoints = (int)points.size();
+        if (numPoints < 3) return;
+        if (FramePacket* packet = recording_packet()) {
+            packet->call([points, color, convex] {
+                drawPolygon(points, color, convex);
+            });
+            return;
+        }
+        const int numIndices = (numPoints - 2) * 3;
+        if (numPoints > sceneData->MAX_VERTS ||
+            numIndices > sceneData->MAX_IND) {
+            log_warn("polygon with {} points is too big for the poly batch",
+                     numPoints);
+            return;
+        }
 
-        for (int i = 0; i < (int)points.size() + 2; i++) {
-            sceneData->pvbufferptr->position =
-                glm::vec3{points[i % points.size()], 0.f};
-            sceneData->pvbufferptr->color = color;
+        if (sceneData->polyVertexCount + numPoints > sceneData->MAX_VERTS ||
+            (int)sceneData->polyIndices.size() + numIndices >
+                sceneData->MAX_IND) {
+            next_batch();
+        }
 
+        const uint32_t firstIndex = (uint32_t)sceneData->polyVertexCount;
+        // if ear clipping fails the polygon crosses itself, a fan is wrong
+        // too but at least it draws something
+        if (convex || !triangulate_ear_clip(points, firstIndex,
+                                            sceneData->polyIndices)) {
+            triangulate_fan(points.size(), firstIndex, sceneData->polyIndices);
+        }
+
+        ensure_mapped(sceneData->polyVB, sceneData->pvbufferstart,
+                      sceneData->pvbufferptr);
+        for (const glm::vec2& point : points) {
+            sceneData->pvbufferptr->position = glm::vec3{point, 0.f};
+            sceneData->pvbufferptr->color = color;
             sceneData->pvbufferptr++;
-            sceneData->polyVertexCount += 1;
         }
+        sceneData->polyVertexCount += numPoints;
+    }
 
-        next_batch();
+    // Same as drawLine but width is in world units, goes in the quad batch
+    // so any number of these (with any widths) share the quad draw calls
+    static void drawLine(const glm::vec3& start, const glm::vec3& end,
+                         const glm::vec4& color, float width) {
+        glm::vec2 dir = glm::vec2{end.x - start.x, end.y - start.y};
+        float length = glm::length(dir);
+        if (length <= 0.f) return;
+        glm::vec2 offset = glm::vec2{-dir.y, dir.x} * (width * 0.5f / length);
+
+        const std::array<glm::vec3, 4> positions = {{
+            {start.x - offset.x, start.y - offset.y, start.z},
+            {end.x - offset.x, end.y - offset.y, end.z},
+            {end.x + offset.x, end.y + offset.y, end.z},
+            {start.x + offset.x, start.y + offset.y, start.z},
+        }};
+        submit_quad(positions, color, sceneData->whiteTexture,
+                    sceneData->white->textureCoords, start.z);
     }
 
-    static void setLineThickness(float thickness) { glLineWidth(thickness); };
+    // In pixels, only used for GL_LINES when there is no OrthoCamera
+    // (otherwise thick lines turn into quads)
+    static void setLineThickness(float thickness) {
+        if (FramePacket* packet = recording_packet()) {
+            packet->call([thickness] { setLineThickness(thickness); });
+            return;
+        }
+        sceneData->lineThickness = thickness;
+        RendererAPI::get().setLineWidth(thickness);
+    };
+
+    // For drawing textures whose color already has alpha multiplied in,
+    // like a Framebuffer that was drawn into with the normal blend. Call
+    // it outside begin() / end() and turn it back off after
+    static void setPremultipliedAlpha(bool premultiplied) {
+        if (FramePacket* packet = recording_packet()) {
+            packet->call([premultiplied] {
+                setPremultipliedAlpha(premultiplied);
+            });
+            return;
+        }
+        RendererAPI::get().setPremultipliedAlpha(premultiplied);
+    }
 
     ////// ////// ////// ////// ////// ////// ////// //////
     //      the draw calls below here, just call one of the ones above
@@ -540,6 +1893,12 @@ struct Renderer {
         Renderer::drawLine(glm::vec3{start, 0.f}, glm::vec3{end, 0.f}, color);
     }
 
+    static void drawLine(const glm::vec2& start, const glm::vec2& end,
+                         const glm::vec4& color, float width) {
+        Renderer::drawLine(glm::vec3{start, 0.f}, glm::vec3{end, 0.f}, color,
+                           width);
+    }
+
     static void drawQuad(const glm::vec2& position, const glm::vec2& size,
                          const glm::vec4& color,
                          const std::string& textureName = DEFAULT_TEX) {
@@ -555,6 +1914,51 @@ struct Renderer {
         Renderer::drawQuad(transform, color, textureName);
     }
 
+    static void drawQuad(const glm::vec2& position, const glm::vec2& size,
+                         const glm::vec4& color, TextureHandle texture) {
+        Renderer::drawQuad(glm::vec3{position.x, position.y, 0.f}, size, color,
+                           texture);
+    }
+
+    static void drawQuad(const glm::vec3& position, const glm::vec2& size,
+                         const glm::vec4& color, TextureHandle texture) {
+        auto transform = glm::translate(imat, position) *
+                         glm::scale(imat, {size.x, size.y, 1.0f});
+        Renderer::drawQuad(transform, color, texture);
+    }
+
+    static void drawQuad(const glm::vec2& position, const glm::vec2& size,
+                         const glm::vec4& color, SubtextureHandle subtexture) {
+        Renderer::drawQuad(glm::vec3{position.x, position.y, 0.f}, size, color,
+                           subtexture);
+    }
+
+    static void drawQuad(const glm::vec3& position, const glm::vec2& size,
+                         const glm::vec4& color, SubtextureHandle subtexture) {
+        auto transform = glm::translate(imat, position) *
+                         glm::scale(imat, {size.x, size.y, 1.0f});
+        Renderer::drawQuad(transform, color, subtexture);
+    }
+
+    static void drawSprite(const glm::vec2& position, const glm::vec2& size,
+                           const glm::vec4& color,
+                           const std::string& textureName = DEFAULT_TEX) {
+        Renderer::drawSprite({position.x, position.y, 0.f}, size, 0.f, color,
+                             textureName);
+    }
+
+    static void drawSprite(const glm::vec2& position, const glm::vec2& size,
+                           const glm::vec4& color, TextureHandle texture) {
+        Renderer::drawSprite({position.x, position.y, 0.f}, size, 0.f, color,
+                             texture);
+    }
+
+    static void drawSprite(const glm::vec2& position, const glm::vec2& size,
+                           const glm::vec4& color, SubtextureHandle subtexture) {
+        Renderer::drawSprite({position.x, position.y, 0.f}, size, 0.f, color,
+                             subtexture);
+    }
+
     static void drawQuadRotated(const glm::vec2& position,
                                 const glm::vec2& size, float angleInRad,
                                 const glm::vec4& color,
@@ -579,3 +1983,9 @@ struct Renderer {
         drawQuad(transform, color, textureName);
     }
 };
+
+inline void Renderer3D::begin(OrthoCamera& cam) {
+    Renderer::sceneData->viewProjection = cam.viewProjection;
+    Renderer::sceneData->cameraUBO->setData(&cam.viewProjection,
+                                            sizeof(glm::mat4));
+}
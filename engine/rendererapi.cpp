@@ -0,0 +1,139 @@
+#include "rendererapi.h"
+
+#include "buffer.h"
+
+RendererAPI::API RendererAPI::api = RendererAPI::API::OpenGL;
+RenderCommandLog RendererAPI::log;
+
+static std::unique_ptr<RendererAPI> s_rendererAPI;
+
+void RendererAPI::setAPI(API a) {
+    M_ASSERT(!s_rendererAPI,
+             "RendererAPI must be chosen before anything is created");
+    api = a;
+}
+
+RendererAPI& RendererAPI::get() {
+    if (!s_rendererAPI) {
+        switch (api) {
+            case API::Null:
+                s_rendererAPI.reset(new NullRendererAPI());
+                break;
+            case API::OpenGL:
+            default:
+                s_rendererAPI.reset(new OpenGLRendererAPI());
+                break;
+        }
+    }
+    return *s_rendererAPI;
+}
+
+unsigned int RendererAPI::genNullID() {
+    // 0 is reserved to mean "unbound" like in GL
+    static unsigned int nextID = 1;
+    return nextID++;
+}
+
+void OpenGLRendererAPI::init() {
+    glEnable(GL_BLEND);
+    // alpha adds up instead of being multiplied by itself, so things drawn
+    // into a transparent Framebuffer keep the right coverage
+    setPremultipliedAlpha(false);
+    // glEnable(GL_DEPTH_TEST);
+    glEnable(GL_LINE_SMOOTH);
+    glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
+}
+
+void OpenGLRendererAPI::setViewport(int x, int y, int width, int height) {
+    glViewport(x, y, width, height);
+}
+
+void OpenGLRendererAPI::setClearColor(const glm::vec4& color) {
+    glClearColor(color.r, color.g, color.b, color.a);
+}
+
+void OpenGLRendererAPI::clear() {
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void OpenGLRendererAPI::setLineWidth(float width) { glLineWidth(width); }
+
+void OpenGLRendererAPI::setPremultipliedAlpha(bool premultiplied) {
+    if (premultiplied) {
+        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        return;
+    }
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE,
+                        GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void OpenGLRendererAPI::drawIndexed(
+    const std::shared_ptr<VertexArray>& vertexArray, int indexCount,
+    int baseVertex) {
+    vertexArray->bind();
+    if (baseVertex) {
+        glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT,
+                                 nullptr, baseVertex);
+        return;
+    }
+    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr);
+}
+
+void OpenGLRendererAPI::drawLines(
+    const std::shared_ptr<VertexArray>& vertexArray, int vertexCount,
+    int firstVertex) {
+    vertexArray->bind();
+    glDrawArrays(GL_LINES, firstVertex, vertexCount);
+}
+
+void OpenGLRendererAPI::drawIndexedInstanced(
+    const std::shared_ptr<VertexArray>& vertexArray, int indexCount,
+    int instanceCount) {
+    vertexArray->bind();
+    glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr,
+                            instanceCount);
+}
+
+void OpenGLRendererAPI::unbindTexture(int slot) {
+    gl_bind_texture(slot, 0);
+}
+
+bool OpenGLRendererAPI::supportsCompressedFormat(unsigned int format) {
+    switch (format) {
+        case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+            return GLEW_EXT_texture_compression_s3tc;
+        case GL_COMPRESSED_RGBA_BPTC_UNORM:
+        case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+            return GLEW_ARB_texture_compression_bptc;
+    }
+    return false;
+}
+
+int OpenGLRendererAPI::maxTextureArrayLayers() {
+    int max = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max);
+    return max;
+}
+
+void NullRendererAPI::drawIndexed(
+    const std::shared_ptr<VertexArray>& vertexArray, int indexCount, int) {
+    vertexArray->bind();
+    log.record(RenderCommandLog::DrawIndexed, vertexArray->rendererID,
+               indexCount);
+}
+
+void NullRendererAPI::drawLines(const std::shared_ptr<VertexArray>& vertexArray,
+                                int vertexCount, int) {
+    vertexArray->bind();
+    log.record(RenderCommandLog::DrawLines, vertexArray->rendererID,
+               vertexCount);
+}
+
+void NullRendererAPI::drawIndexedInstanced(
+    const std::shared_ptr<VertexArray>& vertexArray, int indexCount,
+    int instanceCount) {
+    vertexArray->bind();
+    log.record(RenderCommandLog::DrawIndexed, vertexArray->rendererID,
+               indexCount * instanceCount);
+}
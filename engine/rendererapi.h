@@ -0,0 +1,173 @@
+#pragma once
+
+#include <algorithm>
+
+#include "pch.hpp"
+
+struct VertexArray;
+
+// Everything the Null backend was asked to do, in order.
+// This lets us measure the cpu side of batch building on machines
+// that dont have a gpu (or a window) like our linux build boxes
+struct RenderCommandLog {
+    enum Type {
+        SetData = 0,
+        BindVertexArray,
+        BindVertexBuffer,
+        BindIndexBuffer,
+        BindTexture,
+        BindShader,
+        BindFramebuffer,
+        UploadUniform,
+        DrawIndexed,
+        DrawLines,
+        Clear,
+    };
+
+    struct Command {
+        Type type;
+        // rendererID of whatever was touched (texture, buffer, shader)
+        unsigned int id;
+        // bytes for SetData, texture slot for BindTexture
+        // and element count for draws
+        int size;
+    };
+
+    std::vector<Command> commands;
+    // turn this off for really long benchmarks so the
+    // log doesnt grow forever, the counters are still kept
+    bool keepCommands = true;
+
+    size_t bytesUploaded = 0;
+    int setDataCalls = 0;
+    int bindCalls = 0;
+    int drawCalls = 0;
+    int elementsDrawn = 0;
+
+    void record(Type type, unsigned int id = 0, int size = 0) {
+        switch (type) {
+            case SetData:
+                setDataCalls++;
+                bytesUploaded += size;
+                break;
+            case BindVertexArray:
+            case BindVertexBuffer:
+            case BindIndexBuffer:
+            case BindTexture:
+            case BindShader:
+            case BindFramebuffer:
+                bindCalls++;
+                break;
+            case DrawIndexed:
+            case DrawLines:
+                drawCalls++;
+                elementsDrawn += size;
+                break;
+            default:
+                break;
+        }
+        if (keepCommands) commands.push_back(Command{type, id, size});
+    }
+
+    int count(Type type) const {
+        return (int)std::count_if(
+            commands.begin(), commands.end(),
+            [type](const Command& c) { return c.type == type; });
+    }
+
+    void reset() {
+        commands.clear();
+        bytesUploaded = 0;
+        setDataCalls = 0;
+        bindCalls = 0;
+        drawCalls = 0;
+        elementsDrawn = 0;
+    }
+};
+
+// Thin layer over the handful of global state calls the Renderer makes
+// so we can swap OpenGL out for something else (currently just Null)
+//
+// Pick the api before calling Renderer::init(), all the ::create()
+// functions in buffer.h look at this to decide what to make
+struct RendererAPI {
+    enum class API {
+        OpenGL = 0,
+        // Doesnt touch the gpu at all, just writes into RendererAPI::log
+        Null,
+    };
+
+    static API api;
+    static RenderCommandLog log;
+
+    static void setAPI(API a);
+    static RendererAPI& get();
+    static bool isNull() { return api == API::Null; }
+    // Null resources still need unique ids so that
+    // things like Texture2D::operator== keep working
+    static unsigned int genNullID();
+
+    virtual ~RendererAPI() {}
+    virtual void init() = 0;
+    virtual void setViewport(int x, int y, int width, int height) = 0;
+    virtual void setClearColor(const glm::vec4& color) = 0;
+    virtual void clear() = 0;
+    virtual void setLineWidth(float width) = 0;
+    // for colors that already have alpha multiplied in, off is the
+    // blend init() sets up
+    virtual void setPremultipliedAlpha(bool premultiplied) = 0;
+    virtual void drawIndexed(const std::shared_ptr<VertexArray>& vertexArray,
+                             int indexCount, int baseVertex = 0) = 0;
+    virtual void drawLines(const std::shared_ptr<VertexArray>& vertexArray,
+                           int vertexCount, int firstVertex = 0) = 0;
+    virtual void drawIndexedInstanced(
+        const std::shared_ptr<VertexArray>& vertexArray, int indexCount,
+        int instanceCount) = 0;
+    virtual void unbindTexture(int slot) = 0;
+    // can textures in this block compressed format be sampled
+    virtual bool supportsCompressedFormat(unsigned int format) = 0;
+    virtual int maxTextureArrayLayers() = 0;
+};
+
+struct OpenGLRendererAPI : public RendererAPI {
+    virtual void init() override;
+    virtual void setViewport(int x, int y, int width, int height) override;
+    virtual void setClearColor(const glm::vec4& color) override;
+    virtual void clear() override;
+    virtual void setLineWidth(float width) override;
+    virtual void setPremultipliedAlpha(bool premultiplied) override;
+    virtual void drawIndexed(const std::shared_ptr<VertexArray>& vertexArray,
+                             int indexCount, int baseVertex = 0) override;
+    virtual void drawLines(const std::shared_ptr<VertexArray>& vertexArray,
+                           int vertexCount,
+                           int firstVertex = 0) override;
+    virtual void drawIndexedInstanced(
+        const std::shared_ptr<VertexArray>& vertexArray, int indexCount,
+        int instanceCount) override;
+    virtual void unbindTexture(int slot) override;
+    virtual bool supportsCompressedFormat(unsigned int format) override;
+    virtual int maxTextureArrayLayers() override;
+};
+
+struct NullRendererAPI : public RendererAPI {
+    virtual void init() override {}
+    virtual void setViewport(int, int, int, int) override {}
+    virtual void setClearColor(const glm::vec4&) override {}
+    virtual void clear() override { log.record(RenderCommandLog::Clear); }
+    virtual void setLineWidth(float) override {}
+    virtual void setPremultipliedAlpha(bool) override {}
+    virtual void drawIndexed(const std::shared_ptr<VertexArray>& vertexArray,
+                             int indexCount, int baseVertex = 0) override;
+    virtual void drawLines(const std::shared_ptr<VertexArray>& vertexArray,
+                           int vertexCount,
+                           int firstVertex = 0) override;
+    virtual void drawIndexedInstanced(
+        const std::shared_ptr<VertexArray>& vertexArray, int indexCount,
+        int instanceCount) override;
+    virtual void unbindTexture(int) override {}
+    virtual bool supportsCompressedFormat(unsigned int) override {
+        return true;
+    }
+    // GL 3.0 guarantees at least 256
+    virtual int maxTextureArrayLayers() override { return 256; }
+};
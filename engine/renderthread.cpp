@@ -0,0 +1,101 @@
+#include "renderthread.h"
+
+void RenderThread::start(Window* w) {
+    if (running()) return;
+    window = w;
+    stopping = false;
+    pending = false;
+    recordIndex = 0;
+    for (Renderer::FramePacket& packet : packets) {
+        packet.clear();
+        packet.cullingEnabled = Renderer::sceneData->cullingEnabled;
+        packet.hasCullRect = Renderer::sceneData->hasCullRect;
+        packet.cullRect = Renderer::sceneData->cullRect;
+    }
+
+    window->releaseContext();
+    thread = std::thread(&RenderThread::loop, this);
+    Renderer::recording_packet() = &packets[recordIndex];
+}
+
+void RenderThread::stop() {
+    if (!running()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    packetReady.notify_one();
+    thread.join();
+
+    Renderer::recording_packet() = nullptr;
+    packets[recordIndex].clear();
+    window->makeContextCurrent();
+    // the worker arenas go back to this thread
+    Renderer::sceneData->recordingThread = std::this_thread::get_id();
+}
+
+void RenderThread::wait() {
+    prof give_me_a_name(__PROFILE_FUNC__);
+    if (!running()) return;
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!pending) return;
+    stats.waits++;
+    auto start = std::chrono::high_resolution_clock::now();
+    packetDone.wait(lock, [this] { return !pending; });
+    stats.waitTime +=
+        std::chrono::duration<float>(
+            std::chrono::high_resolution_clock::now() - start)
+            .count();
+}
+
+void RenderThread::submit() {
+    prof give_me_a_name(__PROFILE_FUNC__);
+    if (!running()) return;
+    wait();
+
+    Renderer::FramePacket& recorded = packets[recordIndex];
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = true;
+        recordIndex = 1 - recordIndex;
+    }
+    packetReady.notify_one();
+
+    // isVisible() keeps answering with whatever the last frame ended on
+    Renderer::FramePacket& next = packets[recordIndex];
+    next.cullingEnabled = recorded.cullingEnabled;
+    next.hasCullRect = recorded.hasCullRect;
+    next.cullRect = recorded.cullRect;
+    Renderer::recording_packet() = &next;
+}
+
+void RenderThread::loop() {
+    window->makeContextCurrent();
+    Renderer::sceneData->recordingThread = std::this_thread::get_id();
+
+    while (true) {
+        Renderer::FramePacket* packet = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            packetReady.wait(lock, [this] { return stopping || pending; });
+            if (!pending) break;
+            packet = &packets[1 - recordIndex];
+        }
+
+        Renderer::stats.reset();
+        Renderer::stats.begin();
+        Renderer::replay(*packet);
+        window->swapBuffers();
+        Renderer::stats.end();
+        packet->clear();
+        stats.framesRendered++;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending = false;
+        }
+        packetDone.notify_one();
+    }
+
+    window->releaseContext();
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "pch.hpp"
+//
+#include "renderer.h"
+#include "window.h"
+
+// Plays back the Renderer on its own thread, so the main thread can update
+// the next frame while this one is submitted and swapped (with vsync on,
+// the swap alone can be most of a frame)
+//
+// While its running the main thread only records: every Renderer call
+// goes into a Renderer::FramePacket, and submit() hands that packet to the
+// render thread. There are two packets, the main thread fills one while
+// the other is played back, so it only waits when the render thread is a
+// whole frame behind
+//
+// The render thread owns the gl context the whole time, anything else
+// that talks to gl has to go through Renderer::enqueue()
+//
+// App::run() uses this when AppSettings::renderThread is set and every
+// layer splitsRender(), see Layer
+struct RenderThread {
+    struct Stats {
+        std::atomic<int> framesRendered = 0;
+        // wait() / submit() calls that had to wait for the render thread
+        int waits = 0;
+        float waitTime = 0.f;
+    };
+    Stats stats;
+
+    static RenderThread& get() {
+        static RenderThread renderThread;
+        return renderThread;
+    }
+
+    ~RenderThread() { stop(); }
+
+    bool running() const { return thread.joinable(); }
+
+    // Main thread, takes the gl context away from it
+    void start(Window* window);
+
+    // Main thread, finishes whatever was submitted and gives the context
+    // back. Anything recorded since the last submit() is thrown away
+    void stop();
+
+    // Main thread, blocks until the render thread is done with the last
+    // packet. Until the next submit() its not touching anything, so this
+    // is where to change things it reads (like the TextureLibrary)
+    void wait();
+
+    // Main thread, hands over everything recorded since the last submit()
+    void submit();
+
+   private:
+    Window* window = nullptr;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable packetReady;
+    std::condition_variable packetDone;
+
+    std::array<Renderer::FramePacket, 2> packets;
+    // the one the main thread is recording into
+    int recordIndex = 0;
+    // the other one has been submitted and isnt done yet
+    bool pending = false;
+    bool stopping = false;
+
+    RenderThread() {}
+
+    void loop();
+};
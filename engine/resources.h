@@ -1,6 +1,8 @@
 
 #pragma once
 
+#include "assetpack.h"
+#include "file.h"
 #include "globals.h"
 #include "pch.hpp"
 
@@ -11,6 +13,8 @@ struct ResourceLocations {
     // TODO consider just keeping these strings inside the codebase instead of
     // files?
     std::string shaders;
+    // linked shader programs from earlier runs, empty turns the cache off
+    std::string shaderCache;
 
     ResourceLocations() {
         folder = "./resources";
@@ -21,10 +25,23 @@ struct ResourceLocations {
         fonts = fmt::format("{}/fonts", folder);
         keybindings = fmt::format("{}/keybindings.ini", folder);
         shaders = fmt::format("{}/shaders", folder);
+        shaderCache = fmt::format("{}/shader_cache", folder);
         log_trace("Will be loading resources from {}", folder);
         log_trace("Font folder {}", fonts);
         log_trace("Shaders folder {}", shaders);
         log_trace("Keybindings file: {}", keybindings);
+        AssetPack::get().open(folder);
+        FileIndex::get().index(folder);
+    }
+
+    // after adding or moving files under folder while running
+    void refresh() { FileIndex::get().refresh(folder); }
+
+    // Whats in the asset pack for path (relative to folder or starting with
+    // it), if there is a pack and its in there. Check this before disk
+    std::optional<std::string_view> find_in_pack(
+        const std::string& path) const {
+        return AssetPack::get().find(path);
     }
 };
 
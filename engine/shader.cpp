@@ -2,40 +2,45 @@
 
 #include "shader.h"
 
+#include "glstate.h"
+#include "rendererapi.h"
 #include "resources.h"
 
-Shader::Shader(const std::string &n, const std::string &vertexSource,
-               const std::string &fragmentSource)
-    : name(n) {
-    std::unordered_map<GLenum, std::string> shaderSources;
-    shaderSources[GL_VERTEX_SHADER] = vertexSource;
-    shaderSources[GL_FRAGMENT_SHADER] = fragmentSource;
-    compile(shaderSources);
+std::shared_ptr<Shader> Shader::create(const std::string &name,
+                                       const std::string &vertexSource,
+                                       const std::string &fragmentSource) {
+    Sources sources;
+    sources[GL_VERTEX_SHADER] = vertexSource;
+    sources[GL_FRAGMENT_SHADER] = fragmentSource;
+    return create(name, sources);
 }
 
-Shader::Shader(const std::string &filepath) {
-    name = nameFromFilePath(filepath);
-
+std::shared_ptr<Shader> Shader::create(const std::string &filepath) {
     log_trace("Trying to load shader at: {} ", filepath);
     std::string contents = readFromFile(filepath);
     log_trace("Got shader contents from file {} ", filepath);
-    std::unordered_map<GLenum, std::string> sources = preProcess(contents);
+    Sources sources = preProcess(contents);
     log_trace("finished preprocessing shader {} ", filepath);
-    compile(sources);
+    return create(nameFromFilePath(filepath), sources);
 }
 
-Shader::Shader(const std::string &name, const char *data, int size)
-    : name(name) {
+std::shared_ptr<Shader> Shader::create(const std::string &name,
+                                       const char *data, int size) {
     log_trace("Got shader contents of size {} ", size);
     std::string contents(data, data + size);
-    std::unordered_map<GLenum, std::string> sources = preProcess(contents);
+    Sources sources = preProcess(contents);
     log_trace("finished preprocessing shader {} ", name);
-    compile(sources);
+    return create(name, sources);
+}
+
+std::shared_ptr<Shader> Shader::create(const std::string &name,
+                                       const Sources &sources) {
+    if (RendererAPI::isNull()) return std::make_shared<NullShader>(name);
+    return std::make_shared<OpenGLShader>(name, sources);
 }
 
-std::unordered_map<GLenum, std::string> Shader::preProcess(
-    const std::string &source) {
-    std::unordered_map<GLenum, std::string> shaderSources;
+Shader::Sources Shader::preProcess(const std::string &source) {
+    Sources shaderSources;
 
     const char *typeToken = "#type";
     size_t typeTokenLength = strlen(typeToken);
@@ -74,6 +79,10 @@ GLenum Shader::typeFromString(const std::string &type) {
 }
 
 std::string Shader::readFromFile(const std::string &filepath) {
+    if (auto packed = getResourceLocations().find_in_pack(filepath)) {
+        return std::string(*packed);
+    }
+
     std::string result;
     std::ifstream in(
         filepath,
@@ -94,9 +103,30 @@ std::string Shader::readFromFile(const std::string &filepath) {
     return result;
 }
 
-void Shader::compile(
-    const std::unordered_map<GLenum, std::string> &shaderSources) {
+OpenGLShader::OpenGLShader(const std::string &n, const Sources &sources)
+    : Shader(n) {
+    compile(sources);
+}
+
+void OpenGLShader::compile(const Sources &shaderSources) {
+    ShaderCache &cache = ShaderCache::get();
+    uint64_t cacheKey = 0;
+    if (cache.usable()) {
+        cacheKey = cache.key(shaderSources);
+        unsigned int cached = cache.load(name, cacheKey);
+        if (cached) {
+            rendererID = cached;
+            cache_uniforms();
+            return;
+        }
+    }
+    auto compileStart = std::chrono::high_resolution_clock::now();
+
     auto program = glCreateProgram();
+    if (cacheKey) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                            GL_TRUE);
+    }
     std::vector<GLenum> shaderIDs;
     shaderIDs.reserve(shaderSources.size());
 
@@ -172,41 +202,275 @@ void Shader::compile(
     }
 
     rendererID = program;
+    cache_uniforms();
+
+    if (cacheKey) {
+        float compileTime = std::chrono::duration<float>(
+                                std::chrono::high_resolution_clock::now() -
+                                compileStart)
+                                .count();
+        cache.save(name, cacheKey, program, compileTime);
+    }
 }
 
-Shader::~Shader() { glDeleteProgram(rendererID); }
+// Asks the program for every active uniform once, so uploads dont have
+// to do a string lookup in the driver every call
+void OpenGLShader::cache_uniforms() {
+    uniformLocations.clear();
+
+    GLint count = 0;
+    glGetProgramiv(rendererID, GL_ACTIVE_UNIFORMS, &count);
+    GLint maxLength = 0;
+    glGetProgramiv(rendererID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<GLchar> buffer(std::max(maxLength, 1));
+
+    for (GLint i = 0; i < count; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(rendererID, (GLuint)i, (GLsizei)buffer.size(),
+                           &length, &size, &type, buffer.data());
+        std::string uniformName(buffer.data(), length);
+        // uniforms inside a block dont have a location
+        GLint location = glGetUniformLocation(rendererID, uniformName.c_str());
+        if (location == -1) continue;
+
+        auto bracket = uniformName.find('[');
+        if (bracket != std::string::npos) {
+            uniformName = uniformName.substr(0, bracket);
+        }
+        uniformLocations[uniformName] = location;
+    }
 
-void Shader::bind() const { glUseProgram(rendererID); }
-void Shader::unbind() const { glUseProgram(0); }
-void Shader::uploadUniformInt(const std::string &fieldName, const int i) {
+    GLuint cameraBlock = glGetUniformBlockIndex(rendererID, "Camera");
+    if (cameraBlock != GL_INVALID_INDEX) {
+        glUniformBlockBinding(rendererID, cameraBlock, CAMERA_UNIFORM_BINDING);
+    }
+}
+
+int OpenGLShader::getUniformLocation(const std::string &fieldName) {
+    auto it = uniformLocations.find(fieldName);
+    if (it != uniformLocations.end()) return it->second;
+
+    // not active (or optimized out), remember that too so we only ask once
     GLint location = glGetUniformLocation(rendererID, fieldName.c_str());
+    uniformLocations[fieldName] = location;
+    return location;
+}
+
+OpenGLShader::~OpenGLShader() {
+    GLState::get().forgetProgram(rendererID);
+    glDeleteProgram(rendererID);
+}
+
+void OpenGLShader::bind() const { gl_use_program(rendererID); }
+void OpenGLShader::unbind() const { gl_use_program(0); }
+void OpenGLShader::uploadUniformInt(const std::string &fieldName,
+                                    const int i) {
+    GLint location = getUniformLocation(fieldName);
     glUniform1i(location, i);
 }
-void Shader::uploadUniformIntArray(const std::string &fieldName, int *values,
-                                   int count) {
-    GLint location = glGetUniformLocation(rendererID, fieldName.c_str());
+void OpenGLShader::uploadUniformIntArray(const std::string &fieldName,
+                                         int *values, int count) {
+    GLint location = getUniformLocation(fieldName);
     glUniform1iv(location, count, values);
 }
-void Shader::uploadUniformFloat(const std::string &fieldName, float value) {
-    GLint location = glGetUniformLocation(rendererID, fieldName.c_str());
+void OpenGLShader::uploadUniformFloat(const std::string &fieldName,
+                                      float value) {
+    GLint location = getUniformLocation(fieldName);
     glUniform1f(location, value);
 }
-void Shader::uploadUniformFloat3(const std::string &fieldName,
-                                 const glm::vec3 &values) {
-    GLint location = glGetUniformLocation(rendererID, fieldName.c_str());
+void OpenGLShader::uploadUniformFloat3(const std::string &fieldName,
+                                       const glm::vec3 &values) {
+    GLint location = getUniformLocation(fieldName);
     glUniform3f(location, values.x, values.y, values.z);
 }
-void Shader::uploadUniformFloat4(const std::string &fieldName,
-                                 const glm::vec4 &values) {
-    GLint location = glGetUniformLocation(rendererID, fieldName.c_str());
+void OpenGLShader::uploadUniformFloat4(const std::string &fieldName,
+                                       const glm::vec4 &values) {
+    GLint location = getUniformLocation(fieldName);
     glUniform4f(location, values.x, values.y, values.z, values.w);
 }
-void Shader::uploadUniformMat4(const std::string &fieldName,
-                               const glm::mat4 &matrix) {
-    GLint location = glGetUniformLocation(rendererID, fieldName.c_str());
+void OpenGLShader::uploadUniformMat4(const std::string &fieldName,
+                                     const glm::mat4 &matrix) {
+    GLint location = getUniformLocation(fieldName);
     glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(matrix));
 }
 
+NullShader::NullShader(const std::string &n) : Shader(n) {
+    rendererID = RendererAPI::genNullID();
+}
+
+void NullShader::bind() const {
+    if (!GLState::get().useProgram(rendererID)) return;
+    RendererAPI::log.record(RenderCommandLog::BindShader, rendererID);
+}
+void NullShader::uploadUniformInt(const std::string &, const int) {
+    RendererAPI::log.record(RenderCommandLog::UploadUniform, rendererID,
+                            sizeof(int));
+}
+void NullShader::uploadUniformIntArray(const std::string &, int *,
+                                       int count) {
+    RendererAPI::log.record(RenderCommandLog::UploadUniform, rendererID,
+                            count * sizeof(int));
+}
+void NullShader::uploadUniformFloat(const std::string &, float) {
+    RendererAPI::log.record(RenderCommandLog::UploadUniform, rendererID,
+                            sizeof(float));
+}
+void NullShader::uploadUniformFloat3(const std::string &, const glm::vec3 &) {
+    RendererAPI::log.record(RenderCommandLog::UploadUniform, rendererID,
+                            sizeof(glm::vec3));
+}
+void NullShader::uploadUniformFloat4(const std::string &, const glm::vec4 &) {
+    RendererAPI::log.record(RenderCommandLog::UploadUniform, rendererID,
+                            sizeof(glm::vec4));
+}
+void NullShader::uploadUniformMat4(const std::string &, const glm::mat4 &) {
+    RendererAPI::log.record(RenderCommandLog::UploadUniform, rendererID,
+                            sizeof(glm::mat4));
+}
+
+static ShaderCache shaderCache__DO_NOT_USE;
+ShaderCache &ShaderCache::get() { return shaderCache__DO_NOT_USE; }
+
+namespace {
+// at the front of every cache file
+struct ShaderCacheHeader {
+    uint32_t magic;
+    uint32_t format;
+    // how long it took to build from source, for stats.timeSaved
+    float compileTime;
+};
+constexpr uint32_t SHADER_CACHE_MAGIC = 0x52444853;  // SHDR
+}  // namespace
+
+bool ShaderCache::usable() {
+    return enabled && GLEW_ARB_get_program_binary &&
+           !getResourceLocations().shaderCache.empty();
+}
+
+uint64_t ShaderCache::key(const Shader::Sources &sources) {
+    if (driver.empty()) {
+        for (GLenum which : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+            const GLubyte *str = glGetString(which);
+            if (str) driver += (const char *)str;
+            driver += '\n';
+        }
+    }
+
+    // unordered_map order isnt stable, so hash them by stage
+    std::vector<GLenum> stages;
+    for (auto &kv : sources) stages.push_back(kv.first);
+    std::sort(stages.begin(), stages.end());
+
+    uint64_t hash = fnv1a_64(driver);
+    for (GLenum stage : stages) {
+        hash = fnv1a_64(std::to_string(stage), hash);
+        hash = fnv1a_64(sources.at(stage), hash);
+    }
+    return hash;
+}
+
+std::string ShaderCache::path_for(const std::string &name,
+                                  uint64_t key) const {
+    return fmt::format("{}/{}_{:016x}.bin", getResourceLocations().shaderCache,
+                       name, key);
+}
+
+unsigned int ShaderCache::load(const std::string &name, uint64_t key) {
+    auto start = std::chrono::high_resolution_clock::now();
+    const std::string path = path_for(name, key);
+
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    if (!in.is_open()) {
+        stats.misses++;
+        return 0;
+    }
+    ShaderCacheHeader header{};
+    in.read((char *)&header, sizeof(header));
+    // a short file leaves the rest of header as zeros, not garbage
+    const bool truncated = in.gcount() != (std::streamsize)sizeof(header);
+    std::vector<char> binary;
+    if (!truncated) {
+        binary.assign(std::istreambuf_iterator<char>(in),
+                      std::istreambuf_iterator<char>());
+    }
+    in.close();
+
+    if (truncated || header.magic != SHADER_CACHE_MAGIC || binary.empty()) {
+        log_warn("Shader cache file {} is corrupt, ignoring it", path);
+        std::__fs::filesystem::remove(path);
+        stats.misses++;
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.format, binary.data(),
+                    (GLsizei)binary.size());
+    GLint isLinked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
+    if (isLinked == GL_FALSE) {
+        // usually means the driver changed in a way the key didnt catch
+        log_info("Driver rejected cached shader {}, recompiling", name);
+        glDeleteProgram(program);
+        std::__fs::filesystem::remove(path);
+        stats.misses++;
+        return 0;
+    }
+
+    float loadTime = std::chrono::duration<float>(
+                         std::chrono::high_resolution_clock::now() - start)
+                         .count();
+    stats.hits++;
+    stats.timeSaved += std::max(0.f, header.compileTime - loadTime);
+    log_trace("Loaded shader {} from the cache in {:.2f} ms", name,
+              loadTime * 1000.f);
+    return program;
+}
+
+void ShaderCache::save(const std::string &name, uint64_t key,
+                       unsigned int program, float compileTime) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &format, binary.data());
+    if (written <= 0) return;
+
+    std::error_code ec;
+    std::__fs::filesystem::create_directories(
+        getResourceLocations().shaderCache, ec);
+    if (ec) {
+        log_warn("Couldnt create shader cache folder {}: {}",
+                 getResourceLocations().shaderCache, ec.message());
+        return;
+    }
+
+    // older versions of this shader are never going to match again
+    const std::string prefix = name + "_";
+    for (auto const &entry : std::__fs::filesystem::directory_iterator{
+             getResourceLocations().shaderCache}) {
+        std::string filename = entry.path().filename().string();
+        if (filename.rfind(prefix, 0) == 0 &&
+            filename.size() == prefix.size() + 16 + 4) {
+            std::__fs::filesystem::remove(entry.path(), ec);
+        }
+    }
+
+    const std::string path = path_for(name, key);
+    std::ofstream out(path, std::ios::out | std::ios::binary);
+    if (!out.is_open()) {
+        log_warn("Couldnt write shader cache file {}", path);
+        return;
+    }
+    ShaderCacheHeader header{SHADER_CACHE_MAGIC, format, compileTime};
+    out.write((const char *)&header, sizeof(header));
+    out.write(binary.data(), written);
+}
+
 void ShaderLibrary::add(const std::shared_ptr<Shader> &shader) {
     if (shaders.find(shader->name) != shaders.end()) {
         log_warn(
@@ -219,16 +483,21 @@ void ShaderLibrary::add(const std::shared_ptr<Shader> &shader) {
     shaders[shader->name] = shader;
 }
 std::shared_ptr<Shader> ShaderLibrary::load(const std::string &path) {
+    // the pack knows it by name, no need to go looking through the folder
+    if (auto packed = getResourceLocations().find_in_pack(path)) {
+        return load_binary(nameFromFilePath(path), packed->data(),
+                           (int)packed->size());
+    }
     const auto abs_path =
         get_absolute_path_to(getResourceLocations().folder, path);
-    auto shader = std::make_shared<Shader>(abs_path);
+    auto shader = Shader::create(abs_path);
     add(shader);
     return shader;
 }
 
 std::shared_ptr<Shader> ShaderLibrary::load_binary(const std::string &name,
                                                    const char *data, int size) {
-    auto shader = std::make_shared<Shader>(name, data, size);
+    auto shader = Shader::create(name, data, size);
     add(shader);
     return shader;
 }
@@ -4,39 +4,126 @@
 #include "file.h"
 #include "pch.hpp"
 
-// https://www.khronos.org/opengl/wiki/Shader_Compilation
+// Any shader with a `uniform Camera { mat4 viewProjection; }` block gets
+// it bound here, Renderer keeps the buffer at this binding up to date
+constexpr unsigned int CAMERA_UNIFORM_BINDING = 0;
+
+// Saves linked programs with glGetProgramBinary so later runs can skip
+// compiling, see ResourceLocations::shaderCache for where they go
+//
+// Binaries are keyed on the shader source and the driver, so editing a
+// shader or updating drivers just misses and recompiles. The driver can
+// also reject a binary for its own reasons, which is treated the same
+struct ShaderCache {
+    struct Stats {
+        int hits = 0;
+        int misses = 0;
+        // compile time the hits would have cost (minus loading them)
+        float timeSaved = 0.f;
+    } stats;
+    bool enabled = true;
+
+    static ShaderCache &get();
+
+    bool usable();
+    uint64_t key(const std::unordered_map<GLenum, std::string> &sources);
+    // 0 if there was nothing usable in the cache
+    unsigned int load(const std::string &name, uint64_t key);
+    void save(const std::string &name, uint64_t key, unsigned int program,
+              float compileTime);
+
+   private:
+    // vendor + renderer + version, only read once
+    std::string driver;
+    std::string path_for(const std::string &name, uint64_t key) const;
+};
+
+// Like the buffers in buffer.h, use create() and you get an OpenGLShader
+// or a NullShader depending on RendererAPI
 struct Shader {
+    using Sources = std::unordered_map<GLenum, std::string>;
+
     std::string name;
-    int rendererID;
+    int rendererID = 0;
 
-    Shader(const std::string &n, const std::string &vertexSource,
-           const std::string &fragmentSource);
+    static std::shared_ptr<Shader> create(const std::string &name,
+                                          const std::string &vertexSource,
+                                          const std::string &fragmentSource);
+    static std::shared_ptr<Shader> create(const std::string &filepath);
+    static std::shared_ptr<Shader> create(const std::string &name,
+                                          const char *data, int size);
+    static std::shared_ptr<Shader> create(const std::string &name,
+                                          const Sources &sources);
 
-    Shader(const std::string &filepath);
-    Shader(const std::string &name, const char *data, int size);
+    static Sources preProcess(const std::string &source);
+    static GLenum typeFromString(const std::string &type);
+    static std::string readFromFile(const std::string &filepath);
 
-    std::unordered_map<GLenum, std::string> preProcess(
-        const std::string &source);
+    virtual ~Shader() {}
 
-    GLenum typeFromString(const std::string &type);
-    std::string readFromFile(const std::string &filepath);
+    virtual void bind() const = 0;
+    virtual void unbind() const = 0;
+    virtual void uploadUniformInt(const std::string &fieldName,
+                                  const int i) = 0;
+    virtual void uploadUniformIntArray(const std::string &fieldName,
+                                       int *values, int count) = 0;
+    virtual void uploadUniformFloat(const std::string &fieldName,
+                                    float value) = 0;
+    virtual void uploadUniformFloat3(const std::string &fieldName,
+                                     const glm::vec3 &values) = 0;
+    virtual void uploadUniformFloat4(const std::string &fieldName,
+                                     const glm::vec4 &values) = 0;
+    virtual void uploadUniformMat4(const std::string &fieldName,
+                                   const glm::mat4 &matrix) = 0;
 
-    void compile(const std::unordered_map<GLenum, std::string> &shaderSources);
+   protected:
+    Shader(const std::string &n) : name(n) {}
+};
+
+// https://www.khronos.org/opengl/wiki/Shader_Compilation
+struct OpenGLShader : public Shader {
+    // filled after linking, arrays are under their name without the [0]
+    std::unordered_map<std::string, int> uniformLocations;
+
+    OpenGLShader(const std::string &name, const Sources &sources);
+    virtual ~OpenGLShader();
+
+    void compile(const Sources &shaderSources);
+    void cache_uniforms();
+    int getUniformLocation(const std::string &fieldName);
+
+    virtual void bind() const override;
+    virtual void unbind() const override;
+    virtual void uploadUniformInt(const std::string &fieldName,
+                                  const int i) override;
+    virtual void uploadUniformIntArray(const std::string &fieldName,
+                                       int *values, int count) override;
+    virtual void uploadUniformFloat(const std::string &fieldName,
+                                    float value) override;
+    virtual void uploadUniformFloat3(const std::string &fieldName,
+                                     const glm::vec3 &values) override;
+    virtual void uploadUniformFloat4(const std::string &fieldName,
+                                     const glm::vec4 &values) override;
+    virtual void uploadUniformMat4(const std::string &fieldName,
+                                   const glm::mat4 &matrix) override;
+};
 
-    ~Shader();
+// Doesnt compile anything, binds and uploads go into RendererAPI::log
+struct NullShader : public Shader {
+    NullShader(const std::string &name);
 
-    void bind() const;
-    void unbind() const;
-    void uploadUniformInt(const std::string &fieldName, const int i);
-    void uploadUniformIntArray(const std::string &fieldName, int *values,
-                               int count);
-    void uploadUniformFloat(const std::string &fieldName, float value);
-    void uploadUniformFloat3(const std::string &fieldName,
-                             const glm::vec3 &values);
-    void uploadUniformFloat4(const std::string &fieldName,
-                             const glm::vec4 &values);
-    void uploadUniformMat4(const std::string &fieldName,
-                           const glm::mat4 &matrix);
+    virtual void bind() const override;
+    virtual void unbind() const override {}
+    virtual void uploadUniformInt(const std::string &, const int) override;
+    virtual void uploadUniformIntArray(const std::string &, int *,
+                                       int count) override;
+    virtual void uploadUniformFloat(const std::string &, float) override;
+    virtual void uploadUniformFloat3(const std::string &,
+                                     const glm::vec3 &) override;
+    virtual void uploadUniformFloat4(const std::string &,
+                                     const glm::vec4 &) override;
+    virtual void uploadUniformMat4(const std::string &,
+                                   const glm::mat4 &) override;
 };
 
 struct ShaderLibrary {
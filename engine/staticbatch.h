@@ -0,0 +1,250 @@
+#pragma once
+
+#include "pch.hpp"
+//
+#include "renderer.h"
+
+// Quads that (mostly) dont change between frames, like a tile map
+//
+// Add them once, then call draw() every frame between Renderer::begin()
+// and Renderer::end(). The vertices stay on the gpu so drawing is a single
+// call no matter how many quads there are, and changing a quad only
+// re-uploads the chunk of quads its in
+//
+// Note: draw() happens right away, so anything drawn with drawQuad in the
+// same begin()/end() ends up on top of it
+//
+// With a RenderThread running draw() only records the batch, its drawn
+// (and uploaded) on the render thread while the next frame updates.
+// Changes have to go through Renderer::enqueue() so they land between
+// two draws instead of in the middle of one
+struct StaticBatch {
+    // quads per dirty chunk
+    static constexpr int CHUNK_QUADS = 64;
+
+    std::shared_ptr<VertexArray> vertexArray;
+    std::shared_ptr<VertexBuffer> vertexBuffer;
+    // cpu copy, dirty chunks get uploaded from here
+    std::vector<Renderer::QuadVert> verts;
+    // slot 0 is white, same as the Renderer
+    std::array<std::shared_ptr<Texture>, MAX_TEX> textures;
+    int numTextures = 0;
+
+    std::vector<bool> dirtyChunks;
+    bool anyDirty = false;
+    // how many quads the gpu buffer has room for, 0 means it needs to
+    // be (re)created on the next draw()
+    int capacity = 0;
+
+    int numQuads() const { return (int)verts.size() / 4; }
+
+    // Returns the index of the quad, use it with setQuad / setColor
+    int addQuad(const glm::vec3& position, const glm::vec2& size,
+                const glm::vec4& color,
+                TextureHandle texture = TextureHandle()) {
+        const Texture* tex = TextureLibrary::get().get(texture);
+        if (!tex) {
+            texture = TextureLibrary::get().getHandle(DEFAULT_TEX);
+            tex = TextureLibrary::get().get(texture);
+        }
+        return add_quad(position, size, color, texture, tex->textureCoords);
+    }
+
+    int addQuad(const glm::vec3& position, const glm::vec2& size,
+                const glm::vec4& color, SubtextureHandle subtexture) {
+        const Subtexture* sub = TextureLibrary::get().getSubtexture(subtexture);
+        if (!sub || !sub->texture) {
+            return addQuad(position, size, color, TextureHandle());
+        }
+        return add_quad(position, size, color, sub->texture->handle,
+                        sub->textureCoords);
+    }
+
+    int addQuad(const glm::vec2& position, const glm::vec2& size,
+                const glm::vec4& color,
+                TextureHandle texture = TextureHandle()) {
+        return addQuad(glm::vec3{position, 0.f}, size, color, texture);
+    }
+
+    // Moves / resizes / recolors a quad, it keeps its texture
+    void setQuad(int index, const glm::vec3& position, const glm::vec2& size,
+                 const glm::vec4& color) {
+        auto corners = quad_corners(position, size);
+        for (int i = 0; i < 4; i++) {
+            verts[index * 4 + i].position = corners[i];
+            verts[index * 4 + i].color = color;
+        }
+        markDirty(index);
+    }
+
+    void setColor(int index, const glm::vec4& color) {
+        for (int i = 0; i < 4; i++) {
+            verts[index * 4 + i].color = color;
+        }
+        markDirty(index);
+    }
+
+    // If you edit verts directly, tell us which quads changed
+    void markDirty(int firstQuad, int count = 1) {
+        int firstChunk = firstQuad / CHUNK_QUADS;
+        int lastChunk = (firstQuad + count - 1) / CHUNK_QUADS;
+        for (int c = firstChunk; c <= lastChunk; c++) dirtyChunks[c] = true;
+        anyDirty = true;
+    }
+
+    void clear() {
+        verts.clear();
+        dirtyChunks.clear();
+        numTextures = 0;
+        for (auto& texture : textures) texture.reset();
+        anyDirty = false;
+    }
+
+    void draw() {
+        if (Renderer::FramePacket* packet = Renderer::recording_packet()) {
+            packet->call([this] { draw(); });
+            return;
+        }
+        if (verts.empty()) return;
+        prof give_me_a_name(__PROFILE_FUNC__);
+
+        if (numQuads() > capacity) {
+            rebuild();
+        } else if (anyDirty) {
+            upload_dirty();
+        }
+
+        for (int i = 0; i < numTextures; i++) {
+            textures[i]->bind(i);
+        }
+        Renderer::sceneData->textureShader->bind();
+        Renderer::draw_INTERNAL(vertexArray, numQuads() * 6);
+
+        Renderer::stats.drawCalls++;
+        Renderer::stats.quadCount += numQuads();
+    }
+
+   private:
+    static std::array<glm::vec3, 4> quad_corners(const glm::vec3& position,
+                                                 const glm::vec2& size) {
+        glm::vec2 half = size * 0.5f;
+        return {{
+            {position.x - half.x, position.y - half.y, position.z},
+            {position.x + half.x, position.y - half.y, position.z},
+            {position.x + half.x, position.y + half.y, position.z},
+            {position.x - half.x, position.y + half.y, position.z},
+        }};
+    }
+
+    // -1 if we are out of slots
+    int texture_slot(TextureHandle handle) {
+        if (numTextures == 0) {
+            textures[0] = TextureLibrary::get().get(DEFAULT_TEX);
+            numTextures = 1;
+        }
+        for (int i = 0; i < numTextures; i++) {
+            if (textures[i]->handle == handle) return i;
+        }
+        // evicted (or never was), same as drawing it untextured
+        const std::shared_ptr<Texture>& texture =
+            TextureLibrary::get().resolve(handle);
+        if (!texture) return 0;
+        if (numTextures >= MAX_TEX) return -1;
+        textures[numTextures] = texture;
+        return numTextures++;
+    }
+
+    int add_quad(const glm::vec3& position, const glm::vec2& size,
+                 const glm::vec4& color, TextureHandle texture,
+                 const std::array<glm::vec2, 4>& texcoords) {
+        const Texture* tex = TextureLibrary::get().get(texture);
+        if (tex && tex->arrayLayer >= 0) {
+            // our shader only has sampler2Ds
+            log_warn(
+                "StaticBatch cant draw {}, its part of a texture array, "
+                "drawing it as white instead",
+                tex->name);
+            texture = TextureLibrary::get().getHandle(DEFAULT_TEX);
+        }
+
+        int slot = texture_slot(texture);
+        if (slot == -1) {
+            log_warn(
+                "StaticBatch is out of texture slots ({}), drawing this quad "
+                "as white instead",
+                MAX_TEX);
+            slot = 0;
+        }
+
+        int index = numQuads();
+        auto corners = quad_corners(position, size);
+        for (int i = 0; i < 4; i++) {
+            verts.push_back(Renderer::QuadVert{corners[i], color, texcoords[i],
+                                               (float)slot});
+        }
+
+        dirtyChunks.resize((index / CHUNK_QUADS) + 1, false);
+        if (index < capacity) markDirty(index);
+        return index;
+    }
+
+    void rebuild() {
+        capacity = std::max(numQuads(), std::max(capacity * 2, CHUNK_QUADS));
+
+        vertexArray.reset(VertexArray::create());
+        std::vector<Renderer::QuadVert> data(verts);
+        data.resize(capacity * 4);
+        vertexBuffer.reset(VertexBuffer::create(
+            (float*)data.data(),
+            (int)(data.size() * sizeof(Renderer::QuadVert))));
+        vertexBuffer->setLayout(BufferLayout{
+            {"i_pos", BufferType::Float3},
+            {"i_color", BufferType::Float4},
+            {"i_texcoord", BufferType::Float2},
+            {"i_texindex", BufferType::Float},
+        });
+        vertexArray->addVertexBuffer(vertexBuffer);
+
+        std::vector<uint32_t> indices(capacity * 6);
+        for (int q = 0; q < capacity; q++) {
+            uint32_t offset = q * 4;
+            uint32_t* i = indices.data() + (q * 6);
+            i[0] = offset + 0;
+            i[1] = offset + 1;
+            i[2] = offset + 2;
+            i[3] = offset + 2;
+            i[4] = offset + 3;
+            i[5] = offset + 0;
+        }
+        std::shared_ptr<IndexBuffer> indexBuffer(
+            IndexBuffer::create(indices.data(), (unsigned int)indices.size()));
+        vertexArray->setIndexBuffer(indexBuffer);
+
+        std::fill(dirtyChunks.begin(), dirtyChunks.end(), false);
+        anyDirty = false;
+    }
+
+    // Uploads each run of dirty chunks with one call
+    void upload_dirty() {
+        const int vertsPerChunk = CHUNK_QUADS * 4;
+        const int numChunks = (int)dirtyChunks.size();
+        for (int c = 0; c < numChunks; c++) {
+            if (!dirtyChunks[c]) continue;
+
+            int end = c;
+            while (end < numChunks && dirtyChunks[end]) {
+                dirtyChunks[end] = false;
+                end++;
+            }
+
+            int firstVert = c * vertsPerChunk;
+            int lastVert = std::min(end * vertsPerChunk, (int)verts.size());
+            vertexBuffer->setSubData(
+                verts.data() + firstVert,
+                (int)((lastVert - firstVert) * sizeof(Renderer::QuadVert)),
+                (int)(firstVert * sizeof(Renderer::QuadVert)));
+            c = end;
+        }
+        anyDirty = false;
+    }
+};
@@ -2,6 +2,7 @@
 #pragma once
 
 #include <codecvt>
+#include <cstdint>
 #include <locale>
 #include <regex>
 #include <string>
@@ -45,3 +46,13 @@ inline std::string nameFromFilePath(const std::string& filepath) {
     return filepath.substr(lastSlash, count);
 }
 
+// 64 bit FNV-1a, pass the last result as hash to keep going across
+// several strings
+inline uint64_t fnv1a_64(const std::string& data,
+                         uint64_t hash = 0xcbf29ce484222325ull) {
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
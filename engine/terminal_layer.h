@@ -24,7 +24,10 @@ struct TerminalLayer : public Layer {
     std::wstring commandContent = L"test";
     float drawerPctOpen = 0.f;
     std::shared_ptr<GOUI::UIContext> uicontext;
+    GOUI::UICache uiCache;
     int startingHistoryIndex = 0;
+    // new output has to show up even if nobody touched the terminal
+    size_t lastHistorySize = 0;
 
     TerminalLayer() : Layer("Debug Terminal") {
         isMinimized = true;
@@ -80,7 +83,6 @@ struct TerminalLayer : public Layer {
         terminalCameraController->camera.setProjection(
             0.f, App::getSettings().width, App::getSettings().height, 0.f);
 
-        Renderer::begin(terminalCameraController->camera);
         {
             using namespace GOUI;
             auto mouseDown =
@@ -92,7 +94,18 @@ struct TerminalLayer : public Layer {
                               terminalCameraController->camera.viewport     //
                 );
 
+            if (EDITOR_COMMANDS.output_history.size() != lastHistorySize) {
+                lastHistorySize = EDITOR_COMMANDS.output_history.size();
+                uicontext->invalidate();
+            }
+
             uicontext->begin(mouseDown, mousePosition);
+            if (!uiCache.begin(uicontext.get(),
+                               terminalCameraController->camera)) {
+                uicontext->end();
+                uiCache.draw(terminalCameraController->camera);
+                return;
+            }
 
             float h1_fs = 64.f;
             float p_fs = 32.f;
@@ -167,9 +180,10 @@ struct TerminalLayer : public Layer {
                 }
 
             }  // end drawer
+            uiCache.end();
             uicontext->end();
         }
-        Renderer::end();
+        uiCache.draw(terminalCameraController->camera);
     }
 
     bool onKeyPressed(KeyPressedEvent event) {
@@ -181,6 +195,7 @@ struct TerminalLayer : public Layer {
         if (event.keycode == Key::getMapping("Toggle Debugger")) {
             isMinimized = !isMinimized;
             drawerPctOpen = 0.f;
+            uicontext->invalidate();
             return true;
         }
 
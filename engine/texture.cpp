@@ -2,6 +2,12 @@
 
 #include "texture.h"
 
+#include "atlas.h"
+#include "dds.h"
+#include "glstate.h"
+#include "rendererapi.h"
+#include "textureloader.h"
+
 Texture::Texture()
     : name("TEXTURE_HAS_NO_NAME"), width(0), height(0), tilingFactor(1.f) {}
 
@@ -14,30 +20,60 @@ Texture::Texture(const Texture &tex)
       height(tex.height),
       tilingFactor(tex.tilingFactor) {}
 
-Texture2D::Texture2D(const std::string &name, int w, int h)
-    : Texture(name, w, h) {
-    glGenTextures(1, &rendererID);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, rendererID);
+std::shared_ptr<Texture2D> Texture2D::create(const std::string &name, int w,
+                                             int h) {
+    if (RendererAPI::isNull()) {
+        return std::make_shared<NullTexture2D>(name, w, h);
+    }
+    return std::make_shared<OpenGLTexture2D>(name, w, h);
+}
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+std::shared_ptr<Texture2D> Texture2D::create(const std::string &path) {
+    log_trace("Loading texture: {}", path);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    if (path.ends_with(".dds")) {
+        CompressedImage image;
+        const bool loaded = read_dds(path, image);
+        M_ASSERT(loaded, fmt::format("Failed to load texture2d: {}", path));
+        if (!loaded) image.path = path;
+        return create(image);
+    }
+
+    int w, h, channels;
+    stbi_set_flip_vertically_on_load(1);
+    stbi_uc *data = stbi_load(path.c_str(), &w, &h, &channels, 0);
+    M_ASSERT(data, fmt::format("Failed to load texture2d: {}", path));
+
+    auto texture = create(nameFromFilePath(path), w, h, channels, data);
+    texture->path = path;
+    stbi_image_free(data);
+    return texture;
 }
 
-void Texture2D::setData(void *data) {
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA,
-                 GL_UNSIGNED_BYTE, data);
+std::shared_ptr<Texture2D> Texture2D::create(const std::string &name, int w,
+                                             int h, int channels,
+                                             const void *data) {
+    if (RendererAPI::isNull()) {
+        return std::make_shared<NullTexture2D>(name, w, h, channels, data);
+    }
+    return std::make_shared<OpenGLTexture2D>(name, w, h, channels, data);
 }
 
-void Texture2D::setBitmapData(void *data) {
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, GL_RED);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width, height, 0, GL_RED,
-                 GL_UNSIGNED_BYTE, data);
+std::shared_ptr<Texture2D> Texture2D::create(const CompressedImage &image) {
+    const bool supported = supportsFormat(image.format);
+    M_ASSERT(supported,
+             fmt::format("Cant load {}, the driver doesnt support its "
+                         "compression format ({:#x})",
+                         image.path, image.format));
+    if (!supported || image.levels.empty()) {
+        // like a png that failed to load, you get an empty texture
+        auto texture = create(nameFromFilePath(image.path), 0, 0, 4, nullptr);
+        texture->path = image.path;
+        return texture;
+    }
+
+    if (RendererAPI::isNull()) return std::make_shared<NullTexture2D>(image);
+    return std::make_shared<OpenGLTexture2D>(image);
 }
 
 Texture2D::Texture2D(const Texture2D &other) {
@@ -59,16 +95,54 @@ Texture2D &Texture2D::operator=(Texture2D &other) {
     return *this;
 }
 
-Texture2D::Texture2D(const std::string &path) : Texture() {
-    log_trace("Loading texture: {}", path);
+bool Texture2D::supportsFormat(unsigned int format) {
+    return RendererAPI::get().supportsCompressedFormat(format);
+}
 
-    name = nameFromFilePath(path);
+bool Texture2D::describe(const std::string &n, int w, int h, int channels) {
+    name = n;
+    width = w;
+    height = h;
+    bytesPerPixel = channels;
+    log_trace("texture {} has {} channels", name, channels);
+    const bool supported = channels == 1 || channels == 3 || channels == 4;
+    M_ASSERT(supported, "image format not supported: {}", channels);
+    return supported;
+}
 
-    int w, h, channels;
-    stbi_set_flip_vertically_on_load(1);
-    stbi_uc *data = stbi_load(path.c_str(), &w, &h, &channels, 0);
-    M_ASSERT(data, fmt::format("Failed to load texture2d: {}", path));
+void Texture2D::describe(const CompressedImage &image) {
+    name = nameFromFilePath(image.path);
+    path = image.path;
+    width = image.width;
+    height = image.height;
+    mipLevels = (int)image.levels.size();
+    compressed = true;
+    // BC1 is half a byte, close enough
+    bytesPerPixel = 1;
+}
 
+void Texture2D::generateMipmaps() {
+    if (compressed) {
+        log_warn("Cant generate mipmaps for {}, its compressed", name);
+        return;
+    }
+    int size = std::max(width, height);
+    mipLevels = 1;
+    while (size > 1) {
+        size /= 2;
+        mipLevels++;
+    }
+    build_mipmaps();
+}
+
+OpenGLTexture2D::OpenGLTexture2D(const std::string &name, int w, int h)
+    : Texture2D(name, w, h) {
+    gen_texture();
+}
+
+OpenGLTexture2D::OpenGLTexture2D(const std::string &n, int w, int h,
+                                 int channels, const void *data) {
+    describe(n, w, h, channels);
     GLenum internalFormat = 0, dataFormat = 0;
     if (channels == 4) {
         internalFormat = GL_RGBA8;
@@ -80,42 +154,476 @@ Texture2D::Texture2D(const std::string &path) : Texture() {
         internalFormat = GL_RED;
         dataFormat = GL_RED;
     }
-    log_trace("texture {} has {} channels", path, channels);
-    M_ASSERT(internalFormat, "image format not supported: {}", channels);
-
-    this->width = w;
-    this->height = h;
-
-    glGenTextures(1, &rendererID);
-    glBindTexture(GL_TEXTURE_2D, rendererID);
 
+    gen_texture();
     if (channels == 1) {
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, GL_RED);
     }
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, dataFormat,
+                 GL_UNSIGNED_BYTE, data);
+}
+
+OpenGLTexture2D::OpenGLTexture2D(const CompressedImage &image) {
+    describe(image);
+
+    gen_texture();
+    if (mipLevels > 1) {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                        GL_LINEAR_MIPMAP_LINEAR);
+    }
+    // files dont always go all the way down to 1x1
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mipLevels - 1);
+
+    for (size_t level = 0; level < image.levels.size(); level++) {
+        const CompressedImage::Level &info = image.levels[level];
+        glCompressedTexImage2D(GL_TEXTURE_2D, (int)level, image.format,
+                               info.width, info.height, 0, (int)info.size,
+                               image.levelData(level));
+    }
+}
+
+OpenGLTexture2D::~OpenGLTexture2D() {
+    GLState::get().forgetTexture(rendererID);
+    glDeleteTextures(1, &rendererID);
+}
+
+void OpenGLTexture2D::gen_texture() {
+    glGenTextures(1, &rendererID);
+    gl_bind_texture(0, rendererID);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+}
 
-    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, dataFormat,
+void OpenGLTexture2D::setData(void *data) {
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA,
                  GL_UNSIGNED_BYTE, data);
+}
 
-    stbi_image_free(data);
+void OpenGLTexture2D::setBitmapData(void *data) {
+    bytesPerPixel = 1;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, GL_RED);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width, height, 0, GL_RED,
+                 GL_UNSIGNED_BYTE, data);
 }
 
-Texture2D::~Texture2D() { glDeleteTextures(1, &rendererID); }
-void Texture2D::bind(int i) const {
-    glActiveTexture(GL_TEXTURE0 + i);
-    glBindTexture(GL_TEXTURE_2D, rendererID);
+void OpenGLTexture2D::bind(int i) const { gl_bind_texture(i, rendererID); }
+
+void OpenGLTexture2D::build_mipmaps() {
+    gl_bind_texture(0, rendererID);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    GL_LINEAR_MIPMAP_LINEAR);
+}
+
+NullTexture2D::NullTexture2D(const std::string &name, int w, int h)
+    : Texture2D(name, w, h) {
+    rendererID = RendererAPI::genNullID();
+}
+
+NullTexture2D::NullTexture2D(const std::string &n, int w, int h, int channels,
+                             const void *) {
+    describe(n, w, h, channels);
+    rendererID = RendererAPI::genNullID();
+    RendererAPI::log.record(RenderCommandLog::SetData, rendererID,
+                            width * height * channels);
+}
+
+NullTexture2D::NullTexture2D(const CompressedImage &image) {
+    describe(image);
+    rendererID = RendererAPI::genNullID();
+    RendererAPI::log.record(RenderCommandLog::SetData, rendererID,
+                            (int)image.data.size());
+}
+
+void NullTexture2D::setData(void *) {
+    RendererAPI::log.record(RenderCommandLog::SetData, rendererID,
+                            width * height * 4);
+}
+
+void NullTexture2D::setBitmapData(void *) {
+    bytesPerPixel = 1;
+    RendererAPI::log.record(RenderCommandLog::SetData, rendererID,
+                            width * height);
+}
+
+void NullTexture2D::bind(int i) const {
+    if (!GLState::get().bindTexture(i, rendererID)) return;
+    RendererAPI::log.record(RenderCommandLog::BindTexture, rendererID, i);
+}
+
+std::shared_ptr<Texture2DArray> Texture2DArray::create(const std::string &name,
+                                                       int w, int h,
+                                                       int layers) {
+    if (RendererAPI::isNull()) {
+        return std::make_shared<NullTexture2DArray>(name, w, h, layers);
+    }
+    return std::make_shared<OpenGLTexture2DArray>(name, w, h, layers);
+}
+
+void Texture2DArray::setLayerData(int layer, const void *data) {
+    M_ASSERT(layer >= 0 && layer < layers,
+             fmt::format("layer {} is outside of texture array {} ({})", layer,
+                         name, layers));
+    upload_layer(layer, data);
+}
+
+int Texture2DArray::maxLayers() {
+    return RendererAPI::get().maxTextureArrayLayers();
+}
+
+OpenGLTexture2DArray::OpenGLTexture2DArray(const std::string &name, int w,
+                                           int h, int l)
+    : Texture2DArray(name, w, h, l) {
+    glGenTextures(1, &rendererID);
+    gl_bind_texture_array(0, rendererID);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, layers, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+}
+
+OpenGLTexture2DArray::~OpenGLTexture2DArray() {
+    GLState::get().forgetTexture(rendererID);
+    glDeleteTextures(1, &rendererID);
+}
+
+void OpenGLTexture2DArray::upload_layer(int layer, const void *data) {
+    gl_bind_texture_array(0, rendererID);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1,
+                    GL_RGBA, GL_UNSIGNED_BYTE, data);
+}
+
+void OpenGLTexture2DArray::bind(int i) const {
+    gl_bind_texture_array(i, rendererID);
+}
+
+NullTexture2DArray::NullTexture2DArray(const std::string &name, int w, int h,
+                                       int l)
+    : Texture2DArray(name, w, h, l) {
+    rendererID = RendererAPI::genNullID();
+}
+
+void NullTexture2DArray::upload_layer(int, const void *) {
+    RendererAPI::log.record(RenderCommandLog::SetData, rendererID,
+                            width * height * 4);
+}
+
+void NullTexture2DArray::bind(int i) const {
+    if (!GLState::get().bindTextureArray(i, rendererID)) return;
+    RendererAPI::log.record(RenderCommandLog::BindTexture, rendererID, i);
+}
+
+void TextureLibrary::buildTextureArrays(int minLayers) {
+    log_trace("Building texture arrays, at least {} layers each", minLayers);
+
+    struct Image {
+        std::string name;
+        std::vector<uint8_t> pixels;
+        // what it replaces, null for addArrayImage() images
+        std::shared_ptr<Texture> original;
+    };
+    // (width, height) -> images that size
+    std::map<std::pair<int, int>, std::vector<Image>> groups;
+
+    for (auto &pending : pendingArrayImages) {
+        if (textures.find(pending.name) != textures.end()) {
+            log_warn(
+                "Failed to add array image, texture with name {} already "
+                "exists",
+                pending.name);
+            continue;
+        }
+        groups[{pending.width, pending.height}].push_back(
+            Image{pending.name, std::move(pending.pixels), nullptr});
+    }
+    pendingArrayImages.clear();
+
+    for (const auto &kv : textures) {
+        const std::shared_ptr<Texture> &texture = kv.second;
+        if (!texture || texture->temporary || texture->atlasPage ||
+            texture->arrayLayer >= 0 || texture->path.empty()) {
+            continue;
+        }
+        // same as buildAtlas, decode the file again instead of reading
+        // the pixels back from GL
+        int w, h, channels;
+        stbi_set_flip_vertically_on_load(1);
+        stbi_uc *data =
+            stbi_load(texture->path.c_str(), &w, &h, &channels, 4);
+        if (!data) {
+            log_warn("Failed to reload {} for a texture array, leaving it "
+                     "alone",
+                     texture->path);
+            continue;
+        }
+        groups[{w, h}].push_back(
+            Image{texture->name, std::vector<uint8_t>(data, data + (w * h * 4)),
+                  texture});
+        stbi_image_free(data);
+    }
+
+    const int maxLayers = Texture2DArray::maxLayers();
+    int layered = 0;
+    for (auto &kv : groups) {
+        const int w = kv.first.first;
+        const int h = kv.first.second;
+        std::vector<Image> &images = kv.second;
+
+        if ((int)images.size() < minLayers) {
+            // not worth an array, images made in code still need a texture
+            for (const Image &image : images) {
+                if (image.original) continue;
+                auto texture = Texture2D::create(image.name, w, h);
+                texture->setData((void *)image.pixels.data());
+                add(texture);
+            }
+            continue;
+        }
+
+        for (size_t first = 0; first < images.size(); first += maxLayers) {
+            const int count =
+                std::min(maxLayers, (int)(images.size() - first));
+            auto array = Texture2DArray::create(
+                fmt::format("texture_array_{}x{}_{}", w, h,
+                            textureArrays.size()),
+                w, h, count);
+            // not add()ed, the array itself cant go in a sampler2D slot so
+            // only its layers get names and handles
+            textureArrays.push_back(array);
+
+            for (int layer = 0; layer < count; layer++) {
+                const Image &image = images[first + layer];
+                array->setLayerData(layer, image.pixels.data());
+
+                auto layerTexture =
+                    std::make_shared<TextureArrayLayer>(image.name, array,
+                                                        layer);
+                if (!image.original) {
+                    add(layerTexture);
+                    continue;
+                }
+
+                // take over the original's handle and subtextures
+                layerTexture->path = image.original->path;
+                layerTexture->handle = image.original->handle;
+                for (auto &sub : subtextures) {
+                    if (sub.second && sub.second->texture == image.original) {
+                        sub.second->texture = layerTexture;
+                    }
+                }
+                textureHandles[layerTexture->handle.id] = layerTexture;
+                textures[image.name] = layerTexture;
+            }
+            layered += count;
+        }
+    }
+
+    log_info("Texture arrays: {} images in {} arrays", layered,
+             textureArrays.size());
+}
+
+void TextureLibrary::buildAtlas(int pageSize) {
+    log_trace("Building texture atlas, {}x{} pages", pageSize, pageSize);
+    // pixels repeated around each image, see blit_with_padding
+    const int pad = 1;
+
+    struct Image {
+        std::string name;
+        int width;
+        int height;
+        std::vector<uint8_t> pixels;
+        // what it replaces, null for addAtlasImage() images
+        std::shared_ptr<Texture> original;
+        int page = -1;
+        int x = 0;
+        int y = 0;
+    };
+    std::vector<Image> images;
+
+    for (auto &pending : pendingAtlasImages) {
+        images.push_back(Image{pending.name, pending.width, pending.height,
+                               std::move(pending.pixels), nullptr});
+    }
+    pendingAtlasImages.clear();
+
+    for (const auto &kv : textures) {
+        const std::shared_ptr<Texture> &texture = kv.second;
+        if (!texture || texture->temporary || texture->atlasPage ||
+            texture->arrayLayer >= 0 || texture->path.empty()) {
+            continue;
+        }
+        // GL already has the pixels but reading them back isnt a thing
+        // everywhere (GLES), so just decode the file again
+        int w, h, channels;
+        stbi_set_flip_vertically_on_load(1);
+        stbi_uc *data =
+            stbi_load(texture->path.c_str(), &w, &h, &channels, 4);
+        if (!data) {
+            log_warn("Failed to reload {} for the atlas, leaving it alone",
+                     texture->path);
+            continue;
+        }
+        images.push_back(Image{texture->name, w, h,
+                               std::vector<uint8_t>(data, data + (w * h * 4)),
+                               texture});
+        stbi_image_free(data);
+    }
+
+    // tallest first packs a lot tighter with a skyline
+    std::sort(images.begin(), images.end(),
+              [](const Image &a, const Image &b) {
+                  return a.height != b.height ? a.height > b.height
+                                              : a.width > b.width;
+              });
+
+    std::vector<SkylinePacker> packers;
+    for (Image &image : images) {
+        int w = image.width + (pad * 2);
+        int h = image.height + (pad * 2);
+        if (w > pageSize || h > pageSize) {
+            atlasStats.imagesSkipped++;
+            continue;
+        }
+
+        for (size_t p = 0; p < packers.size(); p++) {
+            if (packers[p].insert(w, h, image.x, image.y)) {
+                image.page = (int)p;
+                break;
+            }
+        }
+        if (image.page == -1) {
+            packers.emplace_back(pageSize, pageSize);
+            packers.back().insert(w, h, image.x, image.y);
+            image.page = (int)packers.size() - 1;
+        }
+        image.x += pad;
+        image.y += pad;
+    }
+
+    std::vector<std::shared_ptr<Texture>> pages;
+    const int firstPage = atlasStats.pages;
+    for (size_t p = 0; p < packers.size(); p++) {
+        std::vector<uint8_t> pixels(pageSize * pageSize * 4, 0);
+        for (const Image &image : images) {
+            if (image.page != (int)p) continue;
+            blit_with_padding(pixels, pageSize, image.x, image.y,
+                              image.pixels.data(), image.width, image.height,
+                              pad);
+        }
+
+        std::shared_ptr<Texture> page = Texture2D::create(
+            fmt::format("atlas_page_{}", firstPage + (int)p), pageSize,
+            pageSize);
+        page->atlasPage = true;
+        page->setData(pixels.data());
+        add(page);
+        pages.push_back(page);
+
+        atlasStats.occupancy =
+            ((atlasStats.occupancy * atlasStats.pages) +
+             packers[p].occupancy()) /
+            (atlasStats.pages + 1);
+        atlasStats.pages++;
+    }
+
+    for (const Image &image : images) {
+        if (image.page == -1) {
+            // didnt fit, make it a normal texture unless it already is one
+            if (!image.original) {
+                auto texture = Texture2D::create(image.name, image.width,
+                                                 image.height);
+                texture->setData((void *)image.pixels.data());
+                add(texture);
+            }
+            continue;
+        }
+
+        const std::shared_ptr<Texture> &page = pages[image.page];
+        const glm::vec2 min = {(float)image.x / pageSize,
+                               (float)image.y / pageSize};
+        const glm::vec2 max = {(float)(image.x + image.width) / pageSize,
+                               (float)(image.y + image.height) / pageSize};
+        const int atlasImage = atlasStats.imagesPacked++;
+
+        if (image.original) {
+            // move any subtextures of the original onto the page
+            for (auto &kv : subtextures) {
+                auto &subtexture = kv.second;
+                if (!subtexture || subtexture->texture != image.original) {
+                    continue;
+                }
+                for (auto &coord : subtexture->textureCoords) {
+                    coord = min + (coord * (max - min));
+                }
+                subtexture->texture = page;
+                subtexture->atlasImage = atlasImage;
+                atlasStats.subtexturesRewritten++;
+            }
+
+            textureHandles[image.original->handle.id].reset();
+            textures.erase(image.name);
+        }
+
+        addSubtextureMinMax(page, image.name, min, max);
+        subtextures[image.name]->atlasImage = atlasImage;
+    }
+
+    log_info(
+        "Texture atlas: packed {} images onto {} pages ({:.0f}% used), "
+        "rewrote {} subtextures, skipped {}",
+        atlasStats.imagesPacked, atlasStats.pages,
+        atlasStats.occupancy * 100.f, atlasStats.subtexturesRewritten,
+        atlasStats.imagesSkipped);
 }
 
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wdeprecated-declarations"
 
+TextureHandle TextureLibrary::loadAsync(const std::string &path) {
+    const std::string name = nameFromFilePath(path);
+    TextureHandle existing = getHandle(name);
+    if (existing.valid()) return existing;
+
+    // nothing behind the handle yet, drawQuad falls back to white for it
+    TextureHandle handle = allocate_handle();
+    loadingTextures[name] = handle;
+    TextureLoader::get().load(path, name, handle);
+    return handle;
+}
+
+void TextureLibrary::finishAsync(const std::string &name,
+                                 const std::shared_ptr<Texture> &texture) {
+    auto it = loadingTextures.find(name);
+    if (it == loadingTextures.end()) return;
+    TextureHandle handle = it->second;
+    loadingTextures.erase(it);
+    if (!texture) return;
+
+    if (textures.find(name) != textures.end()) {
+        log_warn(
+            "Failed to finish async texture, texture with name {} was added "
+            "while it was loading",
+            name);
+        return;
+    }
+    texture->handle = handle;
+    textureHandles[handle.id] = texture;
+    textures[name] = texture;
+}
+
 TextureLibrary &TextureLibrary::get() { return textureLibrary__DO_NOT_USE; }
 
 #pragma clang diagnostic pop
@@ -2,12 +2,34 @@
 #pragma once
 
 #include <array>
+#include <list>
 #include <string>
 
 #include "external_include.h"
 #include "log.h"
 #include "strutil.h"
 
+// Ids handed out by the TextureLibrary when a texture / subtexture is added
+// Resolve them once (at load time) and pass them to Renderer::drawQuad
+// so drawing doesnt need to do any string lookups
+//
+// 0 is never handed out, so a default constructed handle is invalid
+struct TextureHandle {
+    uint32_t id = 0;
+    // bumped every time the id is evicted, so a handle kept from before
+    // doesnt find whatever reused the id
+    uint32_t generation = 0;
+    bool valid() const { return id != 0; }
+    bool operator==(const TextureHandle &other) const {
+        return id == other.id && generation == other.generation;
+    }
+};
+
+struct SubtextureHandle {
+    uint32_t id = 0;
+    bool valid() const { return id != 0; }
+};
+
 struct Texture {
     const std::array<glm::vec2, 4> textureCoords = {
         {{0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f}}};
@@ -16,7 +38,26 @@ struct Texture {
     int width;
     int height;
     float tilingFactor;
+    // temporary textures live in the TextureLibrary cache and get evicted
+    // when it goes over its budget, see TextureLibrary::touch()
     bool temporary = false;
+    // our spot in TextureLibrary::cacheOrder, only valid while cached
+    std::list<uint32_t>::iterator cacheIt;
+    bool cached = false;
+    // for the cache budget
+    int bytesPerPixel = 4;
+    // 1 unless it was loaded with mips or generateMipmaps() was called
+    int mipLevels = 1;
+    // block compressed (from a dds), gl cant generate mips for these
+    bool compressed = false;
+    TextureHandle handle;
+    // file this was loaded from, empty if it was made in code
+    std::string path;
+    // true for the pages made by TextureLibrary::buildAtlas()
+    bool atlasPage = false;
+    // >= 0 when this is a TextureArrayLayer, see
+    // TextureLibrary::buildTextureArrays()
+    int arrayLayer = -1;
 
     Texture();
     Texture(const std::string &n, int w, int h);
@@ -30,28 +71,160 @@ struct Texture {
     bool operator==(const Texture &other) const {
         return other.name == this->name;
     }
+
+    size_t byteSize() const { return (size_t)width * height * bytesPerPixel; }
 };
 
-struct Texture2D : public Texture {
-    unsigned int rendererID;
+struct CompressedImage;
 
-    Texture2D(const std::string &name, int w, int h);
+// Like the buffers in buffer.h, use create() and you get an
+// OpenGLTexture2D or a NullTexture2D depending on RendererAPI
+struct Texture2D : public Texture {
+    unsigned int rendererID = 0;
+
+    // empty, fill it with setData() / setBitmapData()
+    static std::shared_ptr<Texture2D> create(const std::string &name, int w,
+                                             int h);
+    // pngs and such through stbi, .dds files through read_dds()
+    static std::shared_ptr<Texture2D> create(const std::string &path);
+    // already decoded pixels (1, 3 or 4 channels), bottom row first
+    static std::shared_ptr<Texture2D> create(const std::string &name, int w,
+                                             int h, int channels,
+                                             const void *data);
+    // every level thats in the image, named after its file
+    static std::shared_ptr<Texture2D> create(const CompressedImage &image);
 
-    virtual void setData(void *data) override;
-    virtual void setBitmapData(void *data) override;
     Texture2D(const Texture2D &other);
     Texture2D &operator=(Texture2D &other);
-    Texture2D(const std::string &path);
-    virtual ~Texture2D();
-    virtual void bind(int i) const override;
+    virtual ~Texture2D() {}
     bool operator==(const Texture2D &other) const {
         return other.rendererID == this->rendererID;
     }
+
+    // Builds the whole mip chain from level 0 and switches to trilinear
+    // minification, so zoomed out cameras read a small level instead of
+    // skipping all over a big one. Costs a third more memory
+    //
+    // Not for atlas pages, the smaller levels blend neighbouring images
+    // together at the edges
+    void generateMipmaps();
+
+    // false if the driver cant sample this compressed format
+    static bool supportsFormat(unsigned int format);
+
+   protected:
+    Texture2D() : Texture() {}
+    Texture2D(const std::string &name, int w, int h) : Texture(name, w, h) {}
+
+    // the bookkeeping every backend does before uploading, false if the
+    // format isnt one we handle
+    bool describe(const std::string &name, int w, int h, int channels);
+    void describe(const CompressedImage &image);
+    virtual void build_mipmaps() = 0;
+};
+
+struct OpenGLTexture2D : public Texture2D {
+    OpenGLTexture2D(const std::string &name, int w, int h);
+    OpenGLTexture2D(const std::string &name, int w, int h, int channels,
+                    const void *data);
+    explicit OpenGLTexture2D(const CompressedImage &image);
+    virtual ~OpenGLTexture2D();
+
+    virtual void setData(void *data) override;
+    virtual void setBitmapData(void *data) override;
+    virtual void bind(int i) const override;
+
+   protected:
+    virtual void build_mipmaps() override;
+
+   private:
+    // glGenTextures, bound to unit 0 with our usual wrap and filters
+    void gen_texture();
+};
+
+// Doesnt touch the gpu, uploads and binds go into RendererAPI::log
+struct NullTexture2D : public Texture2D {
+    NullTexture2D(const std::string &name, int w, int h);
+    NullTexture2D(const std::string &name, int w, int h, int channels,
+                  const void *data);
+    explicit NullTexture2D(const CompressedImage &image);
+
+    virtual void setData(void *data) override;
+    virtual void setBitmapData(void *data) override;
+    virtual void bind(int i) const override;
+
+   protected:
+    virtual void build_mipmaps() override {}
+};
+
+// Same sized rgba images stacked into one texture, a batch can draw from
+// every layer while only taking one texture slot
+struct Texture2DArray : public Texture {
+    unsigned int rendererID = 0;
+    int layers;
+
+    // OpenGLTexture2DArray or NullTexture2DArray, every layer is allocated
+    // right away and setLayerData() only fills them in
+    static std::shared_ptr<Texture2DArray> create(const std::string &name,
+                                                  int w, int h, int layers);
+
+    Texture2DArray(const Texture2DArray &other) = delete;
+    Texture2DArray &operator=(const Texture2DArray &other) = delete;
+    virtual ~Texture2DArray() {}
+
+    // width * height * 4 bytes
+    void setLayerData(int layer, const void *data);
+
+    // how many layers the driver lets us have in one array
+    static int maxLayers();
+
+   protected:
+    Texture2DArray(const std::string &name, int w, int h, int l)
+        : Texture(name, w, h), layers(l) {}
+
+    virtual void upload_layer(int layer, const void *data) = 0;
+};
+
+struct OpenGLTexture2DArray : public Texture2DArray {
+    OpenGLTexture2DArray(const std::string &name, int w, int h, int layers);
+    virtual ~OpenGLTexture2DArray();
+    // binds to GL_TEXTURE_2D_ARRAY, so only sampler2DArray can read it
+    virtual void bind(int i) const override;
+
+   protected:
+    virtual void upload_layer(int layer, const void *data) override;
+};
+
+struct NullTexture2DArray : public Texture2DArray {
+    NullTexture2DArray(const std::string &name, int w, int h, int layers);
+    virtual void bind(int i) const override;
+
+   protected:
+    virtual void upload_layer(int layer, const void *data) override;
+};
+
+// Stands in for a texture that was moved into a Texture2DArray, it keeps
+// the name and handle so drawQuad(handle) still works. The Renderer sees
+// arrayLayer and draws it through the array batch instead of a slot
+struct TextureArrayLayer : public Texture {
+    std::shared_ptr<Texture2DArray> array;
+
+    TextureArrayLayer(const std::string &name,
+                      const std::shared_ptr<Texture2DArray> &arr, int layer)
+        : Texture(name, arr->width, arr->height), array(arr) {
+        arrayLayer = layer;
+    }
+
+    virtual void bind(int i) const override { array->bind(i); }
 };
 
 struct Subtexture {
     std::shared_ptr<Texture> texture;
     std::array<glm::vec2, 4> textureCoords;
+    SubtextureHandle handle;
+    // index of the packed image if this lives on an atlas page, see
+    // TextureLibrary::buildAtlas()
+    int atlasImage = -1;
 
     Subtexture(const std::shared_ptr<Texture> &tex, const glm::vec2 &min,
                const glm::vec2 &max)
@@ -63,21 +236,65 @@ struct Subtexture {
     }
 };
 
+struct AtlasStats {
+    int pages = 0;
+    // images that now share a page instead of being their own texture
+    int imagesPacked = 0;
+    // existing subtextures that got moved onto a page
+    int subtexturesRewritten = 0;
+    // images that didnt fit on a page and were left alone
+    int imagesSkipped = 0;
+    // average used area of the pages, 0 - 1
+    float occupancy = 0.f;
+};
+
+struct TextureCacheStats {
+    // findCached() calls that found the texture
+    int hits = 0;
+    int misses = 0;
+    int evictions = 0;
+    // what the cached textures use right now
+    size_t bytes = 0;
+    size_t peakBytes = 0;
+};
+
 struct TextureLibrary {
     std::map<std::string, std::shared_ptr<Texture>> textures;
     std::map<std::string, std::shared_ptr<Subtexture>> subtextures;
 
-    // TODO think about reconsindering the number of max temporary;
-    // minimum we can support is 2 but we'd have lots of thrash constantly O(n)
-    // to find it in the map ( why not 1? because it would be better in that
-    // case to not even put it in the map since there would be no need to find
-    // someone to evict )
-    //
-    // I tried keeping a totally separate list of temps but had issues with
-    // rendering, it seemed liked the shader wasnt able to find them so we are
-    // colocating them with the normal textures
-    int numTemporaryTextures = 0;
-    const int maxTempTextures = 20;
+    // indexed by handle id, index 0 is always empty
+    // evicted textures leave a nullptr behind until add() reuses the id
+    std::vector<std::shared_ptr<Texture>> textureHandles = {nullptr};
+    std::vector<std::shared_ptr<Subtexture>> subtextureHandles = {nullptr};
+
+    // Temporary textures (mostly ui text) are an LRU cache, they stay in
+    // textures like everything else but are also in cacheOrder, most
+    // recently used first. When they add up to more than cacheBudget bytes
+    // the least recently used ones are evicted (one at a time, never the
+    // one that was just added)
+    size_t cacheBudget = 16 << 20;
+    // handle ids
+    std::list<uint32_t> cacheOrder;
+    TextureCacheStats cacheStats;
+
+    // Everything from load() / loadAsync() gets mipmaps (unless the file
+    // already had them or is compressed without them)
+    bool generateMipmaps = false;
+
+    // raw images waiting for buildAtlas()
+    struct PendingAtlasImage {
+        std::string name;
+        int width;
+        int height;
+        std::vector<uint8_t> pixels;
+    };
+    std::vector<PendingAtlasImage> pendingAtlasImages;
+    AtlasStats atlasStats;
+    // waiting for buildTextureArrays()
+    std::vector<PendingAtlasImage> pendingArrayImages;
+    std::vector<std::shared_ptr<Texture2DArray>> textureArrays;
+    // loadAsync() textures that arent ready yet, name -> handle
+    std::map<std::string, TextureHandle> loadingTextures;
 
     auto size() { return textures.size(); }
     auto begin() { return textures.begin(); }
@@ -103,39 +320,152 @@ struct TextureLibrary {
             return "";
         }
         log_trace("Adding Texture \"{}\" to our library", texture->name);
+
+        texture->handle = allocate_handle();
+        textureHandles[texture->handle.id] = texture;
+        textures[texture->name] = texture;
+
         if (texture->temporary) {
-            numTemporaryTextures++;
+            texture->cacheIt =
+                cacheOrder.insert(cacheOrder.begin(), texture->handle.id);
+            texture->cached = true;
+            cacheStats.bytes += texture->byteSize();
+            cacheStats.peakBytes =
+                std::max(cacheStats.peakBytes, cacheStats.bytes);
+            while (cacheStats.bytes > cacheBudget && cacheOrder.size() > 1) {
+                evict_oldest();
+            }
         }
+        return texture->name;
+    }
 
-        if (numTemporaryTextures > maxTempTextures) {
-            std::string name = "";
-            for (auto i = textures.begin(), last = textures.end(); i != last;) {
-                if (i->second->temporary) {
-                    numTemporaryTextures--;
-                    name = i->second->name;
-                    log_trace(
-                        "Evicting Temporary Texture \"{}\" from our library",
-                        name);
-                    i = textures.erase(i);
-                } else {
-                    ++i;
-                }
-            }
+    // Ids evicted since the last call can be handed out again, Renderer::
+    // endFrame() calls this once nothing queued (sorted quads, worker
+    // arenas, frame packets) can still be using them
+    //
+    // The new handle gets the next generation, so an old handle to an
+    // evicted texture keeps drawing white instead of whatever took its
+    // id. Look those up by name again with findCached()
+    void recycleHandles() {
+        freeHandles.insert(freeHandles.end(), evictedHandles.begin(),
+                           evictedHandles.end());
+        evictedHandles.clear();
+    }
+
+    // Marks a temporary texture as just used, the Renderer does this for
+    // everything it draws so on screen text doesnt get evicted
+    void touch(Texture *texture) {
+        if (!texture->cached || cacheOrder.begin() == texture->cacheIt) {
+            return;
         }
+        cacheOrder.splice(cacheOrder.begin(), cacheOrder, texture->cacheIt);
+    }
 
-        textures[texture->name] = texture;
-        return texture->name;
+    // For code that makes temporary textures on demand, returns the
+    // texture if its still cached (and counts the hit or miss)
+    std::shared_ptr<Texture> findCached(const std::string &name) {
+        auto it = textures.find(name);
+        if (it == textures.end() || !it->second) {
+            cacheStats.misses++;
+            return nullptr;
+        }
+        cacheStats.hits++;
+        touch(it->second.get());
+        return it->second;
     }
 
     const std::string load(const std::string &path) {
-        auto texture = std::make_shared<Texture2D>(path);
+        auto texture = Texture2D::create(path);
+        if (generateMipmaps && texture->mipLevels == 1 &&
+            !texture->compressed) {
+            texture->generateMipmaps();
+        }
         return add(texture);
     }
 
+    // Returns right away instead of blocking on the file, the image is
+    // decoded on a TextureLoader thread and uploaded a frame or so later.
+    // Until then the handle has no texture behind it, so it draws as white
+    // (and stays white if the file cant be loaded)
+    TextureHandle loadAsync(const std::string &path);
+
+    // TextureLoader::publish() calls this once the texture is uploaded
+    void finishAsync(const std::string &name,
+                     const std::shared_ptr<Texture> &texture);
+
     std::shared_ptr<Texture> get(const std::string &name) {
         return textures[name];
     }
 
+    // Returns an invalid handle if there is no texture with this name
+    TextureHandle getHandle(const std::string &name) const {
+        auto it = textures.find(name);
+        if (it == textures.end() || !it->second) {
+            auto loading = loadingTextures.find(name);
+            if (loading != loadingTextures.end()) return loading->second;
+            return TextureHandle();
+        }
+        return it->second->handle;
+    }
+
+    SubtextureHandle getSubtextureHandle(const std::string &name) const {
+        auto it = subtextures.find(name);
+        if (it == subtextures.end() || !it->second) return SubtextureHandle();
+        return it->second->handle;
+    }
+
+    // These dont touch the refcount, so dont hold on to the pointer
+    // nullptr if the handle is invalid or the texture was evicted
+    Texture *get(TextureHandle handle) const { return resolve(handle).get(); }
+
+    // Same as get() but keeps the texture alive, for the Renderer batches
+    const std::shared_ptr<Texture> &resolve(TextureHandle handle) const {
+        static const std::shared_ptr<Texture> none;
+        if (handle.id >= textureHandles.size() ||
+            handleGenerations[handle.id] != handle.generation) {
+            return none;
+        }
+        return textureHandles[handle.id];
+    }
+
+    Subtexture *getSubtexture(SubtextureHandle handle) const {
+        if (handle.id >= subtextureHandles.size()) return nullptr;
+        return subtextureHandles[handle.id].get();
+    }
+
+    // Queue rgba pixels (4 bytes each) to be packed by buildAtlas()
+    // useful for sprites that are generated in code
+    void addAtlasImage(const std::string &name, int w, int h,
+                       const uint8_t *rgba) {
+        pendingAtlasImages.push_back(PendingAtlasImage{
+            name, w, h, std::vector<uint8_t>(rgba, rgba + (w * h * 4))});
+    }
+
+    // Packs every texture that was loaded from a file (and isnt temporary)
+    // plus anything from addAtlasImage() onto pageSize x pageSize pages
+    //
+    // Each packed image becomes a subtexture with the same name, so
+    // drawQuad("name") keeps working, and subtextures of packed textures
+    // are rewritten to point into the page. TextureHandles of packed
+    // textures become invalid, so grab handles after calling this
+    void buildAtlas(int pageSize = 2048);
+
+    // Queue rgba pixels (4 bytes each) to become a layer in
+    // buildTextureArrays()
+    void addArrayImage(const std::string &name, int w, int h,
+                       const uint8_t *rgba) {
+        pendingArrayImages.push_back(PendingAtlasImage{
+            name, w, h, std::vector<uint8_t>(rgba, rgba + (w * h * 4))});
+    }
+
+    // Groups every texture loaded from a file (and isnt temporary) plus
+    // anything from addArrayImage() by size, and each group with at least
+    // minLayers images becomes a Texture2DArray
+    //
+    // Unlike buildAtlas() the names, TextureHandles and subtextures all
+    // stay valid, the textures are swapped for TextureArrayLayers in place
+    void buildTextureArrays(int minLayers = 2);
+
     bool hasMatchingTexture(const std::string &name) {
         return (textures.find(name) != textures.end());
     }
@@ -169,7 +499,11 @@ struct TextureLibrary {
                              const std::string &name, glm::vec2 min,
                              glm::vec2 max) {
         log_trace("Adding subtexture \"{}\" to our library", name);
-        subtextures[name] = std::make_shared<Subtexture>(texture, min, max);
+        auto subtexture = std::make_shared<Subtexture>(texture, min, max);
+        subtexture->handle =
+            SubtextureHandle{(uint32_t)subtextureHandles.size()};
+        subtextureHandles.push_back(subtexture);
+        subtextures[name] = subtexture;
     }
 
     void addSubtexture(const std::string &textureName, const std::string &name,
@@ -177,6 +511,14 @@ struct TextureLibrary {
                        float spriteHeight) {
         auto textureIt = textures.find(textureName);
         if (textureIt == textures.end()) {
+            // the texture might have been packed into an atlas page
+            auto packedIt = subtextures.find(textureName);
+            if (packedIt != subtextures.end() &&
+                packedIt->second->atlasImage != -1) {
+                addPackedSubtexture(packedIt->second, name, x, y,
+                                    spriteWidth, spriteHeight);
+                return;
+            }
             log_warn(
                 "Failed to add subtexture to library, texture with name "
                 "{} was not found",
@@ -220,6 +562,35 @@ struct TextureLibrary {
         addSubtextureMinMax(texture, name, min, max);
     }
 
+    // Same as addSubtexture but for a texture thats on an atlas page,
+    // the sprite grid is relative to the original image
+    void addPackedSubtexture(const std::shared_ptr<Subtexture> &packed,
+                             const std::string &name, float x, float y,
+                             float spriteWidth, float spriteHeight) {
+        if (subtextures.find(name) != subtextures.end()) {
+            log_warn(
+                "Failed to add subtexture to library, subtexture with name "
+                "{} already exists",
+                name);
+            return;
+        }
+        const glm::vec2 pageMin = packed->textureCoords[0];
+        const glm::vec2 pageMax = packed->textureCoords[2];
+        const glm::vec2 imageSize =
+            (pageMax - pageMin) *
+            glm::vec2{packed->texture->width, packed->texture->height};
+
+        glm::vec2 min = {(x * spriteWidth) / imageSize.x,
+                         (y * spriteHeight) / imageSize.y};
+        glm::vec2 max = {((x + 1) * spriteWidth) / imageSize.x,
+                         ((y + 1) * spriteHeight) / imageSize.y};
+
+        addSubtextureMinMax(packed->texture, name,
+                            pageMin + (min * (pageMax - pageMin)),
+                            pageMin + (max * (pageMax - pageMin)));
+        subtextures[name]->atlasImage = packed->atlasImage;
+    }
+
     std::shared_ptr<Subtexture> &getSubtexture(const std::string &name) {
         return subtextures[name];
     }
@@ -228,7 +599,149 @@ struct TextureLibrary {
     static std::shared_ptr<Texture> get_tex(const std::string &name) {
         return TextureLibrary::get().get(name);
     }
+
+   private:
+    // ids of evicted textures, see recycleHandles()
+    std::vector<uint32_t> evictedHandles;
+    std::vector<uint32_t> freeHandles;
+    // by handle id, see TextureHandle::generation
+    std::vector<uint32_t> handleGenerations = {0};
+
+    // the slot it returns is empty until the caller fills it in
+    TextureHandle allocate_handle() {
+        if (!freeHandles.empty()) {
+            const uint32_t id = freeHandles.back();
+            freeHandles.pop_back();
+            return TextureHandle{id, handleGenerations[id]};
+        }
+        textureHandles.push_back(nullptr);
+        handleGenerations.push_back(0);
+        return TextureHandle{(uint32_t)textureHandles.size() - 1, 0};
+    }
+
+    void evict_oldest() {
+        const uint32_t id = cacheOrder.back();
+        cacheOrder.pop_back();
+        // anything still holding it (like a batch) keeps it alive until
+        // its done, we just forget about it
+        std::shared_ptr<Texture> texture = textureHandles[id];
+        textureHandles[id].reset();
+        handleGenerations[id]++;
+        evictedHandles.push_back(id);
+        texture->cached = false;
+        cacheStats.bytes -= texture->byteSize();
+        cacheStats.evictions++;
+        log_trace("Evicting Temporary Texture \"{}\" from our library",
+                  texture->name);
+        textures.erase(texture->name);
+    }
 };
 
+// 16x16 rgba, so 1024 bytes each
+inline std::shared_ptr<Texture> test_temporary_texture(
+    const std::string &name) {
+    auto texture = std::make_shared<NullTexture2D>(name, 16, 16);
+    texture->temporary = true;
+    return texture;
+}
+
+inline void test_texture_cache_evicts_least_recent() {
+    TextureLibrary library;
+    library.cacheBudget = 3 * 1024;
+    for (const char *name : {"a", "b", "c"}) {
+        library.add(test_temporary_texture(name));
+    }
+    TextureHandle b = library.getHandle("b");
+
+    library.touch(library.get(library.getHandle("a")));
+    library.add(test_temporary_texture("d"));
+
+    M_ASSERT(library.cacheStats.evictions == 1, "one over should evict one");
+    M_ASSERT(!library.getHandle("b").valid() && !library.get(b),
+             "b was the least recently used so it should be gone");
+    M_ASSERT(library.getHandle("a").valid(), "a was touched so it stays");
+
+    // findCached counts as a use too, so c outlives a now
+    M_ASSERT(library.findCached("c"), "c should still be cached");
+    M_ASSERT(!library.findCached("b"), "b should be a miss");
+    library.add(test_temporary_texture("e"));
+    M_ASSERT(!library.getHandle("a").valid(), "a should go before c");
+    M_ASSERT(library.getHandle("c").valid(), "c was just used");
+    M_ASSERT(library.cacheStats.hits == 1 && library.cacheStats.misses == 1,
+             "findCached should count a hit and a miss");
+}
+
+inline void test_texture_cache_byte_accounting() {
+    TextureLibrary library;
+    library.cacheBudget = 2 * 1024;
+    // only temporary textures count against the budget
+    library.add(std::make_shared<NullTexture2D>("kept", 64, 64));
+    M_ASSERT(library.cacheStats.bytes == 0,
+             "normal textures arent in the cache");
+
+    for (int i = 0; i < 5; i++) {
+        library.add(test_temporary_texture(fmt::format("t{}", i)));
+    }
+    M_ASSERT(library.cacheStats.bytes == 2 * 1024,
+             "bytes should be back under the budget after evicting");
+    M_ASSERT(library.cacheStats.peakBytes == 3 * 1024,
+             "peak should be the moment before an eviction");
+    M_ASSERT(library.cacheStats.evictions == 3, "three should be evicted");
+    M_ASSERT(library.cacheOrder.size() == 2, "two should be left");
+
+    // a texture bigger than the whole budget still gets to stay
+    auto big = std::make_shared<NullTexture2D>("big", 64, 64);
+    big->temporary = true;
+    library.add(big);
+    M_ASSERT(library.getHandle("big").valid(),
+             "the one just added is never evicted");
+    M_ASSERT(library.cacheStats.bytes == big->byteSize(),
+             "only the new texture should be left");
+}
+
+inline void test_texture_cache_reuses_handles() {
+    TextureLibrary library;
+    library.cacheBudget = 1024;
+    library.add(test_temporary_texture("a"));
+    const uint32_t a = library.getHandle("a").id;
+    library.add(test_temporary_texture("b"));
+    const uint32_t b = library.getHandle("b").id;
+    library.add(test_temporary_texture("c"));
+    M_ASSERT(library.getHandle("c").id != a,
+             "evicted ids arent reused before recycleHandles()");
+
+    library.recycleHandles();
+    library.add(test_temporary_texture("d"));
+    const uint32_t d = library.getHandle("d").id;
+    M_ASSERT(d == a || d == b, "an evicted id should be handed out again");
+    M_ASSERT(library.textureHandles.size() == 4,
+             "no new id should be made while there are free ones");
+}
+
+inline void test_texture_cache_stale_handles() {
+    TextureLibrary library;
+    library.cacheBudget = 1024;
+    library.add(test_temporary_texture("a"));
+    const TextureHandle a = library.getHandle("a");
+    library.add(test_temporary_texture("b"));
+    library.recycleHandles();
+    library.add(test_temporary_texture("c"));
+
+    const TextureHandle c = library.getHandle("c");
+    M_ASSERT(c.id == a.id, "c should get a's old id");
+    M_ASSERT(!(c == a), "but not the same handle");
+    M_ASSERT(!library.get(a),
+             "a handle kept from before the eviction shouldnt find c");
+    M_ASSERT(library.get(c) && library.get(c)->name == "c",
+             "the new handle should find c");
+}
+
+inline void test_texture_cache() {
+    test_texture_cache_evicts_least_recent();
+    test_texture_cache_byte_accounting();
+    test_texture_cache_reuses_handles();
+    test_texture_cache_stale_handles();
+}
+
 [[deprecated("You should use TextureLibrary::get()")]] static TextureLibrary
     textureLibrary__DO_NOT_USE;
@@ -0,0 +1,151 @@
+#include "textureloader.h"
+
+#include <algorithm>
+
+#include "texture.h"
+
+TextureLoader::~TextureLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobAdded.notify_all();
+    queueSpace.notify_all();
+    for (std::thread& worker : workers) worker.join();
+}
+
+void TextureLoader::load(const std::string& path, const std::string& name,
+                         TextureHandle handle) {
+    stats.requested++;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (workers.empty()) {
+            // leave a core for the main thread
+            int numThreads = std::clamp(
+                (int)std::thread::hardware_concurrency() - 1, 1, 4);
+            for (int i = 0; i < numThreads; i++) {
+                workers.emplace_back(&TextureLoader::worker_loop, this);
+            }
+        }
+        jobs.push_back(Job{path, name, handle});
+    }
+    jobAdded.notify_one();
+}
+
+void TextureLoader::upload() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ready.empty()) return;
+    }
+    prof give_me_a_name(__PROFILE_FUNC__);
+
+    size_t bytes = 0;
+    while (true) {
+        Decoded decoded;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (ready.empty()) break;
+            size_t size = ready.front().size();
+            if (bytes > 0 && bytes + size > uploadBudget) {
+                stats.overBudget++;
+                break;
+            }
+            decoded = std::move(ready.front());
+            ready.pop_front();
+            queuedBytes -= size;
+        }
+        queueSpace.notify_all();
+
+        std::shared_ptr<Texture2D> texture;
+        if (decoded.isCompressed) {
+            texture = Texture2D::create(decoded.compressed);
+        } else if (decoded.pixels) {
+            texture = Texture2D::create(decoded.job.name, decoded.width,
+                                        decoded.height, decoded.channels,
+                                        decoded.pixels.get());
+            texture->path = decoded.job.path;
+            if (TextureLibrary::get().generateMipmaps) {
+                texture->generateMipmaps();
+            }
+        }
+        if (texture) {
+            bytes += decoded.size();
+            stats.uploaded++;
+            stats.bytesUploaded += decoded.size();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        uploaded.push_back(Uploaded{decoded.job.name, texture});
+    }
+}
+
+int TextureLoader::publish() {
+    std::vector<Uploaded> done;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (uploaded.empty()) return 0;
+        done.swap(uploaded);
+    }
+
+    for (const Uploaded& upload : done) {
+        TextureLibrary::get().finishAsync(upload.name, upload.texture);
+    }
+    stats.published += (int)done.size();
+    return (int)done.size();
+}
+
+void TextureLoader::worker_loop() {
+    // the flag is global unless you ask for the per thread one
+    stbi_set_flip_vertically_on_load_thread(1);
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobAdded.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (stopping) return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        Decoded decoded;
+        decoded.job = std::move(job);
+        if (decoded.job.path.ends_with(".dds")) {
+            // already compressed, it goes up as is (read_dds warns if it
+            // cant read it)
+            decoded.isCompressed =
+                read_dds(decoded.job.path, decoded.compressed);
+        } else {
+            decoded.pixels.reset(stbi_load(decoded.job.path.c_str(),
+                                           &decoded.width, &decoded.height,
+                                           &decoded.channels, 0));
+            // Texture2D only knows how to upload these
+            if (decoded.pixels && decoded.channels != 1 &&
+                decoded.channels != 3 && decoded.channels != 4) {
+                log_warn(
+                    "Failed to load texture {}, {} channels isnt supported",
+                    decoded.job.path, decoded.channels);
+                decoded.pixels.reset();
+            } else if (!decoded.pixels) {
+                log_warn("Failed to load texture {}: {}", decoded.job.path,
+                         stbi_failure_reason());
+            }
+        }
+        if (decoded.ok()) {
+            stats.decoded++;
+        } else {
+            stats.failed++;
+        }
+
+        const size_t size = decoded.size();
+        std::unique_lock<std::mutex> lock(mutex);
+        // an image bigger than the whole queue still gets in when its empty
+        queueSpace.wait(lock, [&] {
+            return stopping || queuedBytes == 0 ||
+                   queuedBytes + size <= maxQueuedBytes;
+        });
+        if (stopping) return;
+        queuedBytes += size;
+        ready.push_back(std::move(decoded));
+    }
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pch.hpp"
+//
+#include "dds.h"
+
+// Decodes images for TextureLibrary::loadAsync() on a few worker threads,
+// so loading a level doesnt stall a frame on stbi_load
+//
+// Decoded images wait in a queue that holds at most maxQueuedBytes (the
+// workers stop decoding when its full). Every frame upload() turns up to
+// uploadBudget bytes of it into textures on the thread with the gl
+// context, and publish() puts those in the TextureLibrary on the main
+// thread. App::run() calls both, with a RenderThread publish() happens
+// while the render thread is between frames
+struct TextureLoader {
+    struct Stats {
+        int requested = 0;
+        std::atomic<int> decoded = 0;
+        std::atomic<int> failed = 0;
+        int uploaded = 0;
+        size_t bytesUploaded = 0;
+        // upload() calls that left images for the next frame
+        int overBudget = 0;
+        int published = 0;
+    };
+    Stats stats;
+
+    // pixel bytes per upload(), one image always goes even if its bigger
+    size_t uploadBudget = 8 << 20;
+    // decoded bytes waiting for upload() before the workers wait
+    size_t maxQueuedBytes = 64 << 20;
+
+    static TextureLoader& get() {
+        static TextureLoader loader;
+        return loader;
+    }
+
+    ~TextureLoader();
+
+    // Main thread, see TextureLibrary::loadAsync()
+    void load(const std::string& path, const std::string& name,
+              TextureHandle handle);
+
+    // Gl thread, creates textures for what the workers finished
+    void upload();
+
+    // Main thread, hands uploaded textures to the TextureLibrary
+    // returns how many
+    int publish();
+
+    // load()s that havent been published yet
+    int pending() const { return stats.requested - stats.published; }
+
+   private:
+    struct StbiFree {
+        void operator()(stbi_uc* data) const { stbi_image_free(data); }
+    };
+
+    struct Job {
+        std::string path;
+        std::string name;
+        TextureHandle handle;
+    };
+
+    struct Decoded {
+        Job job;
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        // null if decoding failed (or its a dds)
+        std::unique_ptr<stbi_uc, StbiFree> pixels;
+        // dds files are read as is, they dont need decoding
+        bool isCompressed = false;
+        CompressedImage compressed;
+
+        bool ok() const { return pixels || isCompressed; }
+        size_t size() const {
+            if (isCompressed) return compressed.data.size();
+            return pixels ? (size_t)width * height * channels : 0;
+        }
+    };
+
+    struct Uploaded {
+        std::string name;
+        // null if decoding failed
+        std::shared_ptr<Texture> texture;
+    };
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable jobAdded;
+    std::condition_variable queueSpace;
+    std::deque<Job> jobs;
+    std::deque<Decoded> ready;
+    size_t queuedBytes = 0;
+    std::vector<Uploaded> uploaded;
+    bool stopping = false;
+
+    TextureLoader() {}
+
+    void worker_loop();
+};
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "pch.hpp"
+
+// Turns a simple polygon (no holes, edges dont cross) into triangles
+//
+// Indices are appended to out as (firstIndex + i) for point i, so the
+// caller can point them straight at wherever it wrote the points.
+// Either winding order works. Returns false (and adds nothing) when there
+// are fewer than 3 points or the polygon couldnt be clipped, which only
+// happens if it isnt simple
+
+// convex polygons are just a fan around the first point
+inline bool triangulate_fan(size_t numPoints, uint32_t firstIndex,
+                            std::vector<uint32_t>& out) {
+    if (numPoints < 3) return false;
+    for (uint32_t i = 1; i + 1 < (uint32_t)numPoints; i++) {
+        out.push_back(firstIndex);
+        out.push_back(firstIndex + i);
+        out.push_back(firstIndex + i + 1);
+    }
+    return true;
+}
+
+inline float triangle_cross(const glm::vec2& a, const glm::vec2& b,
+                            const glm::vec2& c) {
+    return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+// Ear clipping, O(n^2) but polygons here are a few dozen points at most
+inline bool triangulate_ear_clip(const std::vector<glm::vec2>& points,
+                                 uint32_t firstIndex,
+                                 std::vector<uint32_t>& out) {
+    const size_t n = points.size();
+    if (n < 3) return false;
+
+    // twice the signed area, positive means counter clockwise
+    float area = 0.f;
+    for (size_t i = 0; i < n; i++) {
+        const glm::vec2& a = points[i];
+        const glm::vec2& b = points[(i + 1) % n];
+        area += (a.x * b.y) - (b.x * a.y);
+    }
+    const float winding = area < 0.f ? -1.f : 1.f;
+
+    // the points that havent been clipped yet
+    std::vector<uint32_t> remaining(n);
+    for (size_t i = 0; i < n; i++) remaining[i] = (uint32_t)i;
+
+    const size_t startSize = out.size();
+    size_t i = 0;
+    // if we go all the way around without finding an ear, give up
+    size_t sinceLastEar = 0;
+    while (remaining.size() > 3) {
+        if (sinceLastEar > remaining.size()) {
+            out.resize(startSize);
+            return false;
+        }
+
+        const size_t count = remaining.size();
+        uint32_t prev = remaining[(i + count - 1) % count];
+        uint32_t curr = remaining[i % count];
+        uint32_t next = remaining[(i + 1) % count];
+        const glm::vec2& a = points[prev];
+        const glm::vec2& b = points[curr];
+        const glm::vec2& c = points[next];
+
+        bool isEar = triangle_cross(a, b, c) * winding > 0.f;
+        for (size_t k = 0; isEar && k < count; k++) {
+            uint32_t other = remaining[k];
+            if (other == prev || other == curr || other == next) continue;
+            const glm::vec2& p = points[other];
+            // inside (or on the edge of) the ear means its not an ear
+            if (triangle_cross(a, b, p) * winding >= 0.f &&
+                triangle_cross(b, c, p) * winding >= 0.f &&
+                triangle_cross(c, a, p) * winding >= 0.f) {
+                isEar = false;
+            }
+        }
+
+        if (!isEar) {
+            i = (i + 1) % count;
+            sinceLastEar++;
+            continue;
+        }
+
+        out.push_back(firstIndex + prev);
+        out.push_back(firstIndex + curr);
+        out.push_back(firstIndex + next);
+        remaining.erase(remaining.begin() + (i % count));
+        if (i >= remaining.size()) i = 0;
+        sinceLastEar = 0;
+    }
+
+    out.push_back(firstIndex + remaining[0]);
+    out.push_back(firstIndex + remaining[1]);
+    out.push_back(firstIndex + remaining[2]);
+    return true;
+}
+
+// twice the area the triangles in out cover, with firstIndex taken back off
+inline float test_triangulated_area(const std::vector<glm::vec2>& points,
+                                    const std::vector<uint32_t>& out,
+                                    uint32_t firstIndex) {
+    float total = 0.f;
+    for (size_t t = 0; t + 2 < out.size(); t += 3) {
+        total += std::abs(triangle_cross(points[out[t] - firstIndex],
+                                         points[out[t + 1] - firstIndex],
+                                         points[out[t + 2] - firstIndex]));
+    }
+    return total;
+}
+
+inline void test_triangulate_fan() {
+    std::vector<uint32_t> out;
+    M_ASSERT(!triangulate_fan(2, 0, out) && out.empty(),
+             "two points isnt a polygon");
+    M_ASSERT(triangulate_fan(5, 10, out), "a pentagon should fan");
+    const std::vector<uint32_t> expected = {10, 11, 12, 10, 12,
+                                            13, 10, 13, 14};
+    M_ASSERT(out == expected, "fan should go around the first point");
+}
+
+inline void test_triangulate_concave() {
+    // an L, the inner corner (1, 1) is the reflex one
+    const std::vector<glm::vec2> ccw = {
+        {0.f, 0.f}, {2.f, 0.f}, {2.f, 1.f}, {1.f, 1.f}, {1.f, 2.f}, {0.f, 2.f},
+    };
+    const std::vector<glm::vec2> cw(ccw.rbegin(), ccw.rend());
+
+    for (const auto* points : {&ccw, &cw}) {
+        std::vector<uint32_t> out;
+        M_ASSERT(triangulate_ear_clip(*points, 4, out),
+                 "an L should clip in either winding");
+        M_ASSERT(out.size() == (points->size() - 2) * 3,
+                 "should make n - 2 triangles");
+        // the L is 3 unit squares, anything over that went outside
+        M_ASSERT(std::abs(test_triangulated_area(*points, out, 4) - 6.f) <
+                     0.001f,
+                 "triangles should cover the L exactly");
+    }
+}
+
+inline void test_triangulate_collinear() {
+    // square with an extra point in the middle of the bottom edge
+    const std::vector<glm::vec2> points = {
+        {0.f, 0.f}, {1.f, 0.f}, {2.f, 0.f}, {2.f, 2.f}, {0.f, 2.f},
+    };
+    std::vector<uint32_t> out;
+    M_ASSERT(triangulate_ear_clip(points, 0, out),
+             "a point on an edge shouldnt stop clipping");
+    M_ASSERT(out.size() == 9, "should make n - 2 triangles");
+    M_ASSERT(std::abs(test_triangulated_area(points, out, 0) - 8.f) < 0.001f,
+             "triangles should cover the square exactly");
+
+    // everything on one line has no ears at all
+    const std::vector<glm::vec2> line = {{0.f, 0.f}, {1.f, 0.f}, {2.f, 0.f},
+                                         {3.f, 0.f}};
+    out = {7};
+    M_ASSERT(!triangulate_ear_clip(line, 0, out),
+             "a flat polygon cant be clipped");
+    M_ASSERT(out.size() == 1 && out[0] == 7,
+             "a failed clip shouldnt leave anything behind");
+}
+
+inline void test_triangulate() {
+    test_triangulate_fan();
+    test_triangulate_concave();
+    test_triangulate_collinear();
+}
@@ -317,6 +317,8 @@ keyboard focus. Must be called after the widget code has run.
 /////////////////////////////////// ///////////////////////////////////
 */
 
+#include <algorithm>
+#include <climits>
 #include <set>
 #include <string_view>
 
@@ -492,6 +494,33 @@ struct UIContext {
     glm::vec2 mousePosition;
     bool lmouseDown;
 
+    // Render caching (see UICache in uihelper.h)
+    //
+    // begin() checks if any input came in (mouse, keys, scrolling) and if
+    // not, needsRedraw() is false and last frames drawing can be reused.
+    // Widgets that change on their own (animations, the blinking cursor)
+    // ask for the frame they change on with invalidate() / invalidateIn().
+    // If something the ui shows changes outside of it, call invalidate()
+    int frame = 0;
+    // frames since the last one that was drawn, for anything that counts
+    // frames but doesnt run on every one anymore
+    int framesSinceRedraw = 1;
+    int lastRedrawFrame = 0;
+    int redrawFrame = 0;
+    bool dirty = true;
+    glm::vec2 lastMousePosition = glm::vec2{-1.f};
+    bool lastMouseDown = false;
+
+    bool needsRedraw() const { return dirty; }
+
+    // redraw on the next frame
+    void invalidate() { invalidateIn(1); }
+
+    // redraw at most this many frames from now
+    void invalidateIn(int frames) {
+        redrawFrame = std::min(redrawFrame, frame + std::max(frames, 1));
+    }
+
     std::map<std::string, int> keyMapping;
 
     std::set<int> widgetKeys;
@@ -535,7 +564,7 @@ struct UIContext {
         return false;
     }
 
-    float yscrolled;
+    float yscrolled = 0.f;
     bool processMouseScrolled(float yoffset) {
         yscrolled = yoffset;
         return true;
@@ -635,6 +664,19 @@ struct UIContext {
         hotID = rootID;
         lmouseDown = mouseDown;
         mousePosition = mousePos;
+
+        frame++;
+        bool hadInput = mouseDown != lastMouseDown ||
+                        mousePos != lastMousePosition || key || mod ||
+                        keychar || modchar || yscrolled != 0.f;
+        lastMouseDown = mouseDown;
+        lastMousePosition = mousePos;
+        dirty = hadInput || frame >= redrawFrame;
+        if (dirty) {
+            framesSinceRedraw = frame - lastRedrawFrame;
+            lastRedrawFrame = frame;
+            redrawFrame = INT_MAX;
+        }
     }
 
     void end() {
@@ -653,6 +695,8 @@ struct UIContext {
 
         keychar = int();
         modchar = int();
+        // otherwise a scroll nobody used would keep us redrawing
+        yscrolled = 0.f;
         globalContext = nullptr;
     }
 };
@@ -1133,11 +1177,15 @@ inline void _textfield_render(const uuid& id, const WidgetConfig& config,
                                     // text will be too high in the box
                                     config.flipTextY ? -tSize : 0.5f};
 
-    state->cursorBlinkTime = state->cursorBlinkTime + 1;
+    state->cursorBlinkTime =
+        state->cursorBlinkTime + get()->framesSinceRedraw;
     if (state->cursorBlinkTime > 60) {
         state->cursorBlinkTime = 0;
         state->showCursor = !state->showCursor;
     }
+    if (has_kb_focus(id)) {
+        get()->invalidateIn(61 - state->cursorBlinkTime);
+    }
 
     bool shouldWriteCursor = has_kb_focus(id) && state->showCursor;
     std::wstring focusStr = shouldWriteCursor ? L"_" : L"";
@@ -1285,6 +1333,7 @@ bool drawer(const uuid id, WidgetConfig config, float* pct_open = nullptr) {
 
     if (state->heightPct < 1.f) {
         state->heightPct.asT() += 0.1;
+        get()->invalidate();
     }
     get()->drawWidget(
         glm::vec2{config.position.x, state->heightPct * config.position.y},
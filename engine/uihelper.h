@@ -75,4 +75,81 @@ inline void init_uicontext(
     });
 }
 
+// Keeps what a UIContext drew in a Framebuffer and only runs the widgets
+// again when UIContext::needsRedraw() says something changed, every other
+// frame the whole ui is one quad
+//
+//     uicontext->begin(mouseDown, mousePosition);
+//     if (cache.begin(uicontext.get(), camera)) {
+//         ... widgets ...
+//         cache.end();
+//     }
+//     uicontext->end();
+//     cache.draw(camera);
+//
+// Note: the widgets dont run on cached frames, so anything they return
+// (button presses etc) only happens on redraws. Those all need input and
+// input always redraws, so nothing gets lost
+struct UICache {
+    std::shared_ptr<Framebuffer> framebuffer;
+    TextureHandle texture;
+    int redraws = 0;
+    int reuses = 0;
+
+    // true if the widgets need to be drawn, do that and then call end()
+    bool begin(UIContext* context, OrthoCamera& camera) {
+        prof give_me_a_name(__PROFILE_FUNC__);
+        const glm::vec2 viewport = Renderer::sceneData->viewportSize;
+        const int width = std::max(1, (int)viewport.x);
+        const int height = std::max(1, (int)viewport.y);
+
+        bool resized = false;
+        if (!framebuffer) {
+            static int nextCacheID = 0;
+            framebuffer.reset(Framebuffer::create(
+                fmt::format("ui_cache_{}", nextCacheID++), width, height));
+            TextureLibrary::get().add(framebuffer->colorAttachment);
+            texture = framebuffer->colorAttachment->handle;
+            resized = true;
+        } else if (framebuffer->width != width ||
+                   framebuffer->height != height) {
+            framebuffer->resize(width, height);
+            resized = true;
+        }
+
+        if (!resized && !context->needsRedraw()) {
+            reuses++;
+            return false;
+        }
+        redraws++;
+
+        framebuffer->bind();
+        Renderer::clear(glm::vec4{0.f});
+        Renderer::begin(camera);
+        return true;
+    }
+
+    void end() {
+        Renderer::end();
+        framebuffer->unbind();
+    }
+
+    // camera has to see the same area as the one given to begin()
+    void draw(OrthoCamera& camera) {
+        if (!framebuffer) return;
+        // a quad with its corners on the corners of the screen, so the
+        // texture lines up even when the camera flips y
+        const glm::mat4 transform = glm::inverse(camera.viewProjection) *
+                                    glm::scale(imat, {2.f, 2.f, 1.f});
+        // the widgets were blended into a clear framebuffer, so its color
+        // already has alpha in it. blending that with SRC_ALPHA again
+        // would darken anything see through
+        Renderer::setPremultipliedAlpha(true);
+        Renderer::begin(camera);
+        Renderer::drawQuad(transform, glm::vec4{1.f}, texture);
+        Renderer::end();
+        Renderer::setPremultipliedAlpha(false);
+    }
+};
+
 }  // namespace GOUI
@@ -15,7 +15,16 @@ struct WindowConfig {
 
 struct Window {
     virtual ~Window() {}
+    // pollEvents() then swapBuffers()
     virtual void update() = 0;
+    // Events have to be polled on the main thread, swapping can happen on
+    // whichever thread has the context (see RenderThread)
+    virtual void pollEvents() = 0;
+    virtual void swapBuffers() = 0;
+    // The context is current on one thread at a time, release it on the
+    // old thread before making it current on the new one
+    virtual void makeContextCurrent() = 0;
+    virtual void releaseContext() = 0;
     virtual int width() const = 0;
     virtual int height() const = 0;
 
@@ -5,6 +5,7 @@
 #include "../../engine/camera.h"
 #include "../../engine/layer.h"
 #include "../../engine/pch.hpp"
+#include "../../engine/staticbatch.h"
 #include "../../engine/thetastar.h"
 #include "../../engine/vecutil.h"
 #include "colors.h"
@@ -34,6 +35,8 @@ constexpr glm::vec2 tilesize{TILESIZE};
 struct Tile {
     glm::vec2 position;
     glm::vec4 color;
+    // first of our two quads in the StaticBatch, -1 if we arent in one
+    int batchIndex = -1;
 
     void render() {
         auto size = tilesize;
@@ -44,9 +47,27 @@ struct Tile {
         Renderer::drawQuad(pos, size, color);
         Renderer::drawQuad(pos, size, darker);
     }
+
+    void addTo(StaticBatch& batch) {
+        auto size = tilesize;
+        auto pos = (position * size) + (size / 2.f);
+        pos += (size * 0.1f);
+        size *= 0.8;
+        batchIndex = batch.addQuad(pos, size, color);
+        batch.addQuad(pos, size, color / 2.f);
+    }
+
+    // call after changing color
+    void updateIn(StaticBatch& batch) {
+        if (batchIndex == -1) return;
+        batch.setColor(batchIndex, color);
+        batch.setColor(batchIndex + 1, color / 2.f);
+    }
 };
 
 std::array<Tile, MAP_H * MAP_W> grid;
+// the grid barely changes so its kept on the gpu
+StaticBatch gridBatch;
 bool running = true;
 
 inline bool inBound(const glm::vec2& pos) {
@@ -162,12 +183,14 @@ struct DemoLayer : public Layer {
                 }
             }
         }
+
+        for (auto& tile : grid) tile.addTo(gridBatch);
     }
 
     void render() {
         Renderer::begin(cameraController->camera);
         {
-            for (auto t : grid) t.render();
+            gridBatch.draw();
             for (auto pos : path) {
                 if (pos == start || pos == end) continue;
                 Tile{.position = pos, .color = PURPLE}.render();
@@ -238,6 +261,7 @@ struct DemoLayer : public Layer {
     void setTileColor(glm::vec2 location, glm::vec4 color) {
         Tile& tile = grid[location.y * MAP_W + location.x];
         tile.color = color;
+        tile.updateIn(gridBatch);
     }
 
     void place_thing(glm::vec2 location) {
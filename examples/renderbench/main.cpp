@@ -0,0 +1,538 @@
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "../../engine/pch.hpp"
+#include "../../engine/renderer.h"
+#include "../../engine/rendererapi.h"
+#include "../../engine/staticbatch.h"
+
+////////////////////////////////////////
+//
+// headless benchmark for the Renderer batching code
+//
+// Uses RendererAPI::API::Null so nothing is sent to the gpu,
+// this only measures the cpu cost of building batches and lets it run
+// on machines without a display
+//
+////////////////////////////////////////
+
+constexpr int NUM_FRAMES = 20;
+constexpr int NUM_TEXTURES = 24;
+const std::array<int, 4> QUAD_COUNTS = {1000, 10000, 100000, 250000};
+
+std::array<std::string, NUM_TEXTURES> textureNames;
+std::array<TextureHandle, NUM_TEXTURES> textureHandles;
+bool useHandles = false;
+bool useSprites = false;
+
+void init_textures() {
+    for (int i = 0; i < NUM_TEXTURES; i++) {
+        textureNames[i] = fmt::format("bench_{}", i);
+        std::shared_ptr<Texture> tex =
+            Texture2D::create(textureNames[i], 16, 16);
+        TextureLibrary::get().add(tex);
+        textureHandles[i] = TextureLibrary::get().getHandle(textureNames[i]);
+    }
+}
+
+void draw_frame(OrthoCamera& camera, int numQuads) {
+    Renderer::begin(camera);
+    for (int i = 0; i < numQuads; i++) {
+        auto position = glm::vec2{(i % 1000) * 0.01f, (i / 1000) * 0.01f};
+        auto color = glm::vec4{1.f, (i % 255) / 255.f, 0.5f, 1.f};
+        int texture = (i / 2) % NUM_TEXTURES;
+        if (useSprites) {
+            Renderer::drawSprite(position, glm::vec2{0.01f}, color,
+                                 i % 2 == 0 ? TextureHandle()
+                                            : textureHandles[texture]);
+        } else if (useHandles) {
+            Renderer::drawQuad(position, glm::vec2{0.01f}, color,
+                               i % 2 == 0 ? TextureHandle()
+                                          : textureHandles[texture]);
+        } else {
+            Renderer::drawQuad(position, glm::vec2{0.01f}, color,
+                               i % 2 == 0 ? DEFAULT_TEX : textureNames[texture]);
+        }
+    }
+    Renderer::end();
+    Renderer::endFrame();
+}
+
+void run(OrthoCamera& camera, int numQuads, const char* mode) {
+    float totalMs = 0.f;
+    for (int frame = 0; frame < NUM_FRAMES; frame++) {
+        Renderer::stats.reset();
+        RendererAPI::log.reset();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        draw_frame(camera, numQuads);
+        auto end = std::chrono::high_resolution_clock::now();
+        totalMs += std::chrono::duration<float, std::milli>(end - start).count();
+    }
+
+    log_info(
+        "{} {} quads: {:.3f} ms/frame, {} draw calls, {} binds, {} KB "
+        "uploaded, {} culled, {} binds skipped",
+        mode, numQuads, totalMs / NUM_FRAMES, Renderer::stats.drawCalls,
+        RendererAPI::log.bindCalls, RendererAPI::log.bytesUploaded / 1024,
+        Renderer::stats.culledQuads, Renderer::stats.redundantStateCalls());
+}
+
+// per quad drawQuad() vs the bulk drawQuads() on the same quads
+const std::array<int, 3> BULK_QUAD_COUNTS = {10000, 100000, 1000000};
+
+void run_bulk(OrthoCamera& camera, int numQuads) {
+    std::vector<SpriteDesc> sprites(numQuads);
+    for (int i = 0; i < numQuads; i++) {
+        SpriteDesc& sprite = sprites[i];
+        sprite.position = {(i % 1000) * 0.01f, (i / 1000) * 0.01f, 0.f};
+        sprite.size = glm::vec2{0.01f};
+        sprite.color = glm::vec4{1.f, (i % 255) / 255.f, 0.5f, 1.f};
+        sprite.texture = textureHandles[(i / 2) % NUM_TEXTURES];
+    }
+
+    auto time_frames = [&](auto draw) {
+        float totalMs = 0.f;
+        for (int frame = 0; frame < NUM_FRAMES; frame++) {
+            Renderer::stats.reset();
+            auto start = std::chrono::high_resolution_clock::now();
+            Renderer::begin(camera);
+            draw();
+            Renderer::end();
+            Renderer::endFrame();
+            auto end = std::chrono::high_resolution_clock::now();
+            totalMs +=
+                std::chrono::duration<float, std::milli>(end - start).count();
+        }
+        return totalMs / NUM_FRAMES;
+    };
+
+    float perQuadMs = time_frames([&]() {
+        for (const SpriteDesc& sprite : sprites) {
+            Renderer::drawQuad(sprite.position, sprite.size, sprite.color,
+                               sprite.texture);
+        }
+    });
+    float bulkMs = time_frames([&]() { Renderer::drawQuads(sprites); });
+
+    log_info("{} quads: drawQuad {:.3f} ms/frame, drawQuads {:.3f} ms/frame "
+             "({:.2f}x)",
+             numQuads, perQuadMs, bulkMs, perQuadMs / bulkMs);
+
+    // just the corner kernel, everything else drawQuads does is batching
+    std::vector<glm::vec3> corners(sprites.size() * 4);
+    auto time_kernel = [&](auto kernel) {
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int frame = 0; frame < NUM_FRAMES; frame++) {
+            kernel(sprites.data(), sprites.size(), corners.data());
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<float, std::milli>(end - start).count() /
+               NUM_FRAMES;
+    };
+    float scalarMs = time_kernel(transform_sprite_corners_scalar);
+    float kernelMs = time_kernel(transform_sprite_corners);
+    log_info("{} quads: corners scalar {:.3f} ms/frame, {:.3f} ms/frame "
+             "({:.2f}x)",
+             numQuads, scalarMs, kernelMs, scalarMs / kernelMs);
+}
+
+// same quads as run() but split across worker threads, so this is
+// recording in parallel + merging in end()
+//
+// The workers stay up for every frame like a job system would, so each
+// keeps its arena (and the capacity in it) instead of making a new one
+void run_threaded(OrthoCamera& camera, int numQuads, int numThreads) {
+    std::mutex mutex;
+    std::condition_variable frameStart;
+    std::condition_variable frameDone;
+    int frame = -1;
+    int working = 0;
+    bool quit = false;
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < numThreads; t++) {
+        workers.emplace_back([&, t]() {
+            int drawn = -1;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    frameStart.wait(lock,
+                                    [&] { return quit || frame != drawn; });
+                    if (quit) return;
+                    drawn = frame;
+                }
+                for (int i = t; i < numQuads; i += numThreads) {
+                    auto position =
+                        glm::vec2{(i % 1000) * 0.01f, (i / 1000) * 0.01f};
+                    auto color = glm::vec4{1.f, (i % 255) / 255.f, 0.5f, 1.f};
+                    Renderer::drawQuad(
+                        position, glm::vec2{0.01f}, color,
+                        i % 2 == 0 ? TextureHandle()
+                                   : textureHandles[(i / 2) % NUM_TEXTURES]);
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    working--;
+                }
+                frameDone.notify_one();
+            }
+        });
+    }
+
+    float totalMs = 0.f;
+    for (int f = 0; f < NUM_FRAMES; f++) {
+        Renderer::stats.reset();
+        auto start = std::chrono::high_resolution_clock::now();
+
+        Renderer::begin(camera);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            frame = f;
+            working = numThreads;
+        }
+        frameStart.notify_all();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            frameDone.wait(lock, [&] { return working == 0; });
+        }
+        Renderer::end();
+        Renderer::endFrame();
+
+        auto end = std::chrono::high_resolution_clock::now();
+        totalMs += std::chrono::duration<float, std::milli>(end - start).count();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    frameStart.notify_all();
+    for (auto& worker : workers) worker.join();
+
+    log_info("{} threads {} quads: {:.3f} ms/frame, {} draw calls, {} quads",
+             numThreads, numQuads, totalMs / NUM_FRAMES,
+             Renderer::stats.drawCalls, Renderer::stats.quadCount);
+}
+
+// what a RenderThread splits a frame into, recording the packet is what
+// the main thread pays and playing it back is the render threads share
+void run_packet(OrthoCamera& camera, int numQuads) {
+    Renderer::FramePacket packet;
+    float recordMs = 0.f;
+    float replayMs = 0.f;
+    for (int frame = 0; frame < NUM_FRAMES; frame++) {
+        Renderer::stats.reset();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        Renderer::recording_packet() = &packet;
+        draw_frame(camera, numQuads);
+        Renderer::recording_packet() = nullptr;
+        auto recorded = std::chrono::high_resolution_clock::now();
+        Renderer::replay(packet);
+        auto end = std::chrono::high_resolution_clock::now();
+        packet.clear();
+
+        recordMs +=
+            std::chrono::duration<float, std::milli>(recorded - start).count();
+        replayMs +=
+            std::chrono::duration<float, std::milli>(end - recorded).count();
+    }
+
+    log_info("packet {} quads: record {:.3f} ms/frame, replay {:.3f} "
+             "ms/frame, {} draw calls",
+             numQuads, recordMs / NUM_FRAMES, replayMs / NUM_FRAMES,
+             Renderer::stats.drawCalls);
+}
+
+// ui text churn, a few phrases stay on screen while new ones keep
+// getting made, like a scrolling log
+void run_text_cache(OrthoCamera& camera, int numPhrases) {
+    TextureLibrary& library = TextureLibrary::get();
+    library.cacheBudget = 1 << 20;
+    library.cacheStats = TextureCacheStats{};
+    std::vector<uint8_t> bitmap(36 * 360, 255);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < numPhrases; i++) {
+        // half the time its a phrase we have seen recently
+        std::string name = fmt::format("bench_text_{}", i % 2 == 0 ? i : i / 8);
+        Renderer::begin(camera);
+        if (!library.findCached(name)) {
+            auto texture = Texture2D::create(name, 360, 36);
+            texture->setBitmapData(bitmap.data());
+            texture->temporary = true;
+            library.add(texture);
+        }
+        Renderer::drawQuad(glm::vec2{0.f}, glm::vec2{0.1f},
+                           glm::vec4{1.f}, name);
+        Renderer::end();
+        Renderer::endFrame();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    const TextureCacheStats& stats = library.cacheStats;
+    log_info("text cache {} phrases: {:.3f} ms, {} hits, {} misses, {} "
+             "evictions, {} KB cached, {} handle ids",
+             numPhrases,
+             std::chrono::duration<float, std::milli>(end - start).count(),
+             stats.hits, stats.misses, stats.evictions, stats.bytes / 1024,
+             library.textureHandles.size());
+}
+
+// debug style line soup, thin lines go through GL_LINES and thick ones
+// through the quad batch
+void run_lines(OrthoCamera& camera, int numLines, float thickness) {
+    Renderer::setLineThickness(thickness);
+
+    float totalMs = 0.f;
+    for (int frame = 0; frame < NUM_FRAMES; frame++) {
+        Renderer::stats.reset();
+        RendererAPI::log.reset();
+        auto start = std::chrono::high_resolution_clock::now();
+
+        Renderer::begin(camera);
+        for (int i = 0; i < numLines; i++) {
+            auto from = glm::vec2{(i % 100) * 0.02f - 1.f,
+                                  ((i / 100) % 100) * 0.02f - 1.f};
+            Renderer::drawLine(from, from + glm::vec2{0.02f, 0.01f},
+                               glm::vec4{0.f, 1.f, (i % 255) / 255.f, 1.f});
+        }
+        Renderer::end();
+        Renderer::endFrame();
+
+        auto end = std::chrono::high_resolution_clock::now();
+        totalMs += std::chrono::duration<float, std::milli>(end - start).count();
+    }
+
+    log_info("lines ({}px) {}: {:.3f} ms/frame, {} draw calls", thickness,
+             numLines, totalMs / NUM_FRAMES, Renderer::stats.drawCalls);
+    Renderer::setLineThickness(1.f);
+}
+
+// navmesh style hulls (convex) and stars (ear clipped)
+void run_polygons(OrthoCamera& camera, int numPolygons) {
+    std::vector<glm::vec2> hull;
+    std::vector<glm::vec2> star;
+    for (int i = 0; i < 10; i++) {
+        float angle = glm::radians(36.f * i);
+        float radius = i % 2 == 0 ? 0.01f : 0.004f;
+        star.push_back(glm::vec2{cosf(angle), sinf(angle)} * radius);
+        if (i < 6) {
+            angle = glm::radians(60.f * i);
+            hull.push_back(glm::vec2{cosf(angle), sinf(angle)} * 0.01f);
+        }
+    }
+
+    float totalMs = 0.f;
+    std::vector<glm::vec2> points;
+    for (int frame = 0; frame < NUM_FRAMES; frame++) {
+        Renderer::stats.reset();
+        RendererAPI::log.reset();
+        auto start = std::chrono::high_resolution_clock::now();
+
+        Renderer::begin(camera);
+        for (int i = 0; i < numPolygons; i++) {
+            auto offset = glm::vec2{(i % 100) * 0.02f - 1.f,
+                                    ((i / 100) % 100) * 0.02f - 1.f};
+            bool convex = i % 2 == 0;
+            points = convex ? hull : star;
+            for (auto& point : points) point = point + offset;
+            Renderer::drawPolygon(points, glm::vec4{1.f, 0.f, 0.f, 0.5f},
+                                  convex);
+        }
+        Renderer::end();
+        Renderer::endFrame();
+
+        auto end = std::chrono::high_resolution_clock::now();
+        totalMs += std::chrono::duration<float, std::milli>(end - start).count();
+    }
+
+    log_info("polygons {}: {:.3f} ms/frame, {} draw calls, {} KB uploaded",
+             numPolygons, totalMs / NUM_FRAMES, Renderer::stats.drawCalls,
+             RendererAPI::log.bytesUploaded / 1024);
+}
+
+// many small sprites as separate textures, packed into an atlas and as
+// layers of a texture array
+constexpr int NUM_SPRITES = 64;
+std::array<TextureHandle, NUM_SPRITES> looseSprites;
+std::array<SubtextureHandle, NUM_SPRITES> packedSprites;
+std::array<TextureHandle, NUM_SPRITES> layeredSprites;
+
+void init_sprites() {
+    std::vector<uint8_t> pixels(16 * 16 * 4);
+    for (int i = 0; i < NUM_SPRITES; i++) {
+        std::fill(pixels.begin(), pixels.end(), (uint8_t)(i * 4));
+
+        auto name = fmt::format("loose_{}", i);
+        std::shared_ptr<Texture> tex = Texture2D::create(name, 16, 16);
+        tex->setData(pixels.data());
+        TextureLibrary::get().add(tex);
+        looseSprites[i] = TextureLibrary::get().getHandle(name);
+
+        TextureLibrary::get().addAtlasImage(fmt::format("packed_{}", i), 16, 16,
+                                            pixels.data());
+        TextureLibrary::get().addArrayImage(fmt::format("layer_{}", i), 16, 16,
+                                            pixels.data());
+    }
+    TextureLibrary::get().buildAtlas(256);
+    TextureLibrary::get().buildTextureArrays();
+    for (int i = 0; i < NUM_SPRITES; i++) {
+        packedSprites[i] = TextureLibrary::get().getSubtextureHandle(
+            fmt::format("packed_{}", i));
+        layeredSprites[i] =
+            TextureLibrary::get().getHandle(fmt::format("layer_{}", i));
+    }
+}
+
+void run_atlas(OrthoCamera& camera, int numQuads) {
+    const std::array<const char*, 3> modes = {"loose", "atlas", "array"};
+    for (int mode = 0; mode < (int)modes.size(); mode++) {
+        Renderer::stats.reset();
+        Renderer::begin(camera);
+        for (int i = 0; i < numQuads; i++) {
+            auto position = glm::vec2{(i % 1000) * 0.01f, (i / 1000) * 0.01f};
+            if (mode == 1) {
+                Renderer::drawQuad(position, glm::vec2{0.01f}, glm::vec4{1.f},
+                                   packedSprites[i % NUM_SPRITES]);
+            } else if (mode == 2) {
+                Renderer::drawQuad(position, glm::vec2{0.01f}, glm::vec4{1.f},
+                                   layeredSprites[i % NUM_SPRITES]);
+            } else {
+                Renderer::drawQuad(position, glm::vec2{0.01f}, glm::vec4{1.f},
+                                   looseSprites[i % NUM_SPRITES]);
+            }
+        }
+        Renderer::end();
+        Renderer::endFrame();
+
+        log_info("{} {} quads: {} draw calls, {} texture slots, {} slots "
+                 "saved (~{} batches)",
+                 modes[mode], numQuads,
+                 Renderer::stats.drawCalls, Renderer::stats.textureCount,
+                 Renderer::stats.atlasSlotsSaved,
+                 Renderer::stats.atlasBatchesSaved());
+    }
+}
+
+// same grid drawn through a StaticBatch, one tile changes per frame
+void run_static(OrthoCamera& camera, int numQuads) {
+    StaticBatch batch;
+    for (int i = 0; i < numQuads; i++) {
+        batch.addQuad(glm::vec2{(i % 1000) * 0.01f, (i / 1000) * 0.01f},
+                      glm::vec2{0.01f}, glm::vec4{1.f});
+    }
+
+    float totalMs = 0.f;
+    for (int frame = 0; frame < NUM_FRAMES; frame++) {
+        Renderer::stats.reset();
+        RendererAPI::log.reset();
+        auto start = std::chrono::high_resolution_clock::now();
+
+        batch.setColor((frame * 7919) % numQuads,
+                       glm::vec4{0.5f, 0.5f, 1.f, 1.f});
+        Renderer::begin(camera);
+        batch.draw();
+        Renderer::end();
+        Renderer::endFrame();
+
+        auto end = std::chrono::high_resolution_clock::now();
+        totalMs += std::chrono::duration<float, std::milli>(end - start).count();
+    }
+
+    log_info("static {} quads: {:.3f} ms/frame, {} draw calls, {} KB uploaded",
+             numQuads, totalMs / NUM_FRAMES, Renderer::stats.drawCalls,
+             RendererAPI::log.bytesUploaded / 1024);
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+
+    RendererAPI::setAPI(RendererAPI::API::Null);
+    // we only care about the counters, dont keep every command
+    RendererAPI::log.keepCommands = false;
+
+    Renderer::init();
+    init_textures();
+
+    OrthoCamera camera(-1.f, 1.f, -1.f, 1.f);
+
+    for (int numQuads : QUAD_COUNTS) {
+        run(camera, numQuads, "immediate");
+    }
+
+    useHandles = true;
+    for (int numQuads : QUAD_COUNTS) {
+        run(camera, numQuads, "immediate (handles)");
+    }
+
+    useSprites = true;
+    for (int numQuads : QUAD_COUNTS) {
+        run(camera, numQuads, "instanced sprites");
+    }
+    useSprites = false;
+
+    // the grid is 10 units wide so the camera only sees the first tenth
+    // of every row
+    Renderer::setCulling(true);
+    for (int numQuads : QUAD_COUNTS) {
+        run(camera, numQuads, "immediate (culled)");
+    }
+    Renderer::setCulling(false);
+
+    Renderer::setSubmitMode(Renderer::SubmitMode::Sorted);
+    for (int numQuads : QUAD_COUNTS) {
+        run(camera, numQuads, "sorted (handles)");
+    }
+    Renderer::setSubmitMode(Renderer::SubmitMode::Immediate);
+
+    // same quads with half the vertex bytes
+    Renderer::setVertexFormat(Renderer::VertexFormat::Compact);
+    for (int numQuads : QUAD_COUNTS) {
+        run(camera, numQuads, "immediate (compact)");
+    }
+    Renderer::setVertexFormat(Renderer::VertexFormat::Full);
+
+    for (int numQuads : BULK_QUAD_COUNTS) {
+        run_bulk(camera, numQuads);
+    }
+
+    for (int numQuads : QUAD_COUNTS) {
+        run_packet(camera, numQuads);
+    }
+
+    for (int numQuads : QUAD_COUNTS) {
+        run_static(camera, numQuads);
+    }
+
+    for (int numPhrases : {1000, 10000}) {
+        run_text_cache(camera, numPhrases);
+    }
+
+    Renderer::resize(1280, 720);
+    for (int numLines : QUAD_COUNTS) {
+        run_lines(camera, numLines, 1.f);
+        run_lines(camera, numLines, 3.f);
+    }
+
+    for (int numPolygons : QUAD_COUNTS) {
+        run_polygons(camera, numPolygons);
+    }
+
+    init_sprites();
+    for (int numQuads : QUAD_COUNTS) {
+        run_atlas(camera, numQuads);
+    }
+
+    int numThreads =
+        std::max(2, std::min(8, (int)std::thread::hardware_concurrency()));
+    for (int numQuads : QUAD_COUNTS) {
+        run_threaded(camera, numQuads, numThreads);
+    }
+
+    Renderer::shutdown();
+    return 0;
+}
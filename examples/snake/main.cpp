@@ -3,6 +3,7 @@
 #include "../../engine/camera.h"
 #include "../../engine/layer.h"
 #include "../../engine/pch.hpp"
+#include "../../engine/staticbatch.h"
 #include "colors.h"
 
 ////////////////////////////////////////
@@ -31,6 +32,8 @@ constexpr glm::vec2 tilesize{TILESIZE};
 struct Tile {
     glm::vec2 position;
     glm::vec4 color;
+    // first of our two quads in the StaticBatch, -1 if we arent in one
+    int batchIndex = -1;
 
     void render() {
         auto size = tilesize;
@@ -41,9 +44,27 @@ struct Tile {
         Renderer::drawQuad(pos, size, color);
         Renderer::drawQuad(pos, size, darker);
     }
+
+    void addTo(StaticBatch& batch) {
+        auto size = tilesize;
+        auto pos = (position * size) + (size / 2.f);
+        pos += (size * 0.1f);
+        size *= 0.8;
+        batchIndex = batch.addQuad(pos, size, color);
+        batch.addQuad(pos, size, color / 2.f);
+    }
+
+    // call after changing color
+    void updateIn(StaticBatch& batch) {
+        if (batchIndex == -1) return;
+        batch.setColor(batchIndex, color);
+        batch.setColor(batchIndex + 1, color / 2.f);
+    }
 };
 
 std::array<Tile, MAP_H * MAP_W> grid;
+// the grid never changes so its kept on the gpu
+StaticBatch gridBatch;
 bool running = true;
 
 struct DemoLayer : public Layer {
@@ -162,6 +183,8 @@ struct DemoLayer : public Layer {
                 });
             }
         }
+
+        for (auto& tile : grid) tile.addTo(gridBatch);
     }
 
     void go(Time dt) {
@@ -177,7 +200,7 @@ struct DemoLayer : public Layer {
     void render() {
         Renderer::begin(*cameraController);
         {
-            for (auto t : grid) t.render();
+            gridBatch.draw();
             snake.render();
         }
         Renderer::end();
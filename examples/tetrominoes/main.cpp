@@ -3,6 +3,7 @@
 #include "../../engine/camera.h"
 #include "../../engine/layer.h"
 #include "../../engine/pch.hpp"
+#include "../../engine/staticbatch.h"
 
 ////////////////////////////////////////
 //
@@ -35,6 +36,8 @@ constexpr float WIN_RATIO = WIN_W * 1.f / WIN_H;
 struct Tile {
     glm::vec2 position;
     glm::vec4 color;
+    // first of our two quads in the StaticBatch, -1 if we arent in one
+    int batchIndex = -1;
 
     void render() {
         auto size = glm::vec2{TILESIZE};
@@ -45,8 +48,26 @@ struct Tile {
         Renderer::drawQuad(pos, size, color, "white");
         Renderer::drawQuad(pos, size, darker, "white");
     }
+
+    void addTo(StaticBatch& batch) {
+        auto size = glm::vec2{TILESIZE};
+        auto pos = (position * size) + (size / 2.f);
+        pos += (size * 0.1f);
+        size *= 0.8;
+        batchIndex = batch.addQuad(pos, size, color);
+        batch.addQuad(pos, size, color / 2.f);
+    }
+
+    // call after changing color
+    void updateIn(StaticBatch& batch) {
+        if (batchIndex == -1) return;
+        batch.setColor(batchIndex, color);
+        batch.setColor(batchIndex + 1, color / 2.f);
+    }
 };
 std::array<Tile, MAP_H * MAP_W> grid;
+// only the tiles that change get re-uploaded
+StaticBatch gridBatch;
 
 // colors and a way to convert piece type to correct color
 #include "colors.h"
@@ -88,12 +109,16 @@ struct DemoLayer : public Layer {
                 });
             }
         }
+        for (auto& tile : grid) tile.addTo(gridBatch);
         previewPiece.regen({(MAP_W + 1), (MAP_H + 1)});
         currentPiece.regen({(MAP_W / 2), (MAP_H - 1)});
     }
 
     void set_grid_color(int x, int y, glm::vec4 color) {
+        // clearing the top row reaches one past the grid
+        if (y >= MAP_H) return;
         grid[y * MAP_W + x].color = color;
+        grid[y * MAP_W + x].updateIn(gridBatch);
     }
 
     void lock_piece() {
@@ -139,7 +164,7 @@ struct DemoLayer : public Layer {
     void clear_row(int row) {
         for (int i = 0; i < MAP_W; i++) {
             if (i == 0 || i == MAP_W - 1) continue;  // skip walls
-            grid[row * MAP_W + i].color = BLACK;
+            set_grid_color(i, row, BLACK);
         }
     }
 
@@ -167,7 +192,7 @@ struct DemoLayer : public Layer {
     void render() {
         Renderer::begin(cameraController->camera);
         {
-            for (auto t : grid) t.render();
+            gridBatch.draw();
             previewPiece.render();
             currentPiece.render();
             ghostPiece.render(true);
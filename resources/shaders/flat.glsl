@@ -6,7 +6,10 @@
 #type vertex
     #version 400
     in vec3 i_pos;
-    uniform mat4 viewProjection;
+    // shared by every shader, see Renderer::init_camera_buffer
+    layout(std140) uniform Camera {
+        mat4 viewProjection;
+    };
     uniform mat4 transformMatrix;
 
     void main(){
@@ -9,16 +9,16 @@
     in vec3 i_pos;
     in vec4 i_color;
 
-    uniform mat4 viewProjection;
+    // shared by every shader, see Renderer::init_camera_buffer
+    layout(std140) uniform Camera {
+        mat4 viewProjection;
+    };
 
     out vec4 v_color;
 
     void main(){
-        // TODO::
-        // Why when we turn on vP can we not see the lines...
-        // is it because its too thin a line? 
-        // gl_Position = viewProjection * vec4(i_pos, 1.0);
-        gl_Position = vec4(i_pos, 1.0);
+        // world space, same as the quads thick lines turn into
+        gl_Position = viewProjection * vec4(i_pos, 1.0);
         v_color = i_color;
     }
 
@@ -8,7 +8,10 @@
     in vec3 i_pos;
     in vec4 i_color;
 
-    uniform mat4 viewProjection;
+    // shared by every shader, see Renderer::init_camera_buffer
+    layout(std140) uniform Camera {
+        mat4 viewProjection;
+    };
     uniform mat4 transformMatrix;
 
     out vec4 v_color; 
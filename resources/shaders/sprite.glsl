@@ -0,0 +1,57 @@
+////// ////// ////// ////// ////// ////// ////// //////
+//              Sprite Shader
+//      instanced version of texture.glsl, one instance per sprite
+//      and the unit quad is expanded here instead of on the cpu
+////// ////// ////// ////// ////// ////// ////// //////
+
+#type vertex
+    #version 400
+    // per vertex, corner of the unit quad (-0.5 to 0.5)
+    layout(location = 0) in vec2 i_corner;
+    // per instance (see Renderer::SpriteInstance)
+    layout(location = 1) in vec3 i_position;
+    layout(location = 2) in vec2 i_size;
+    layout(location = 3) in float i_rotation;
+    layout(location = 4) in vec4 i_color;
+    layout(location = 5) in vec4 i_uvrect;
+    layout(location = 6) in float i_texindex;
+
+    // shared by every shader, see Renderer::init_camera_buffer
+    layout(std140) uniform Camera {
+        mat4 viewProjection;
+    };
+
+    out vec2 v_texcoord;
+    out vec4 v_color;
+    out float v_texindex;
+
+    void main(){
+        vec2 local = i_corner * i_size;
+        float s = sin(i_rotation);
+        float c = cos(i_rotation);
+        vec2 rotated = vec2(local.x * c - local.y * s,
+                            local.x * s + local.y * c);
+        gl_Position = viewProjection *
+                      vec4(i_position.xy + rotated, i_position.z, 1.0);
+
+        // uvrect is (min.x, min.y, max.x, max.y)
+        v_texcoord = mix(i_uvrect.xy, i_uvrect.zw, i_corner + 0.5);
+        v_color = i_color;
+        v_texindex = i_texindex;
+    }
+
+#type fragment
+    #version 400
+    in vec4 v_color;
+    in vec2 v_texcoord;
+    in float v_texindex;
+
+    uniform sampler2D u_textures[16]; // check SceneData->Max_Tex
+
+    out vec4 frag_color;
+    void main(){
+        vec4 inter = texture(u_textures[int(v_texindex)], v_texcoord);
+        // hide anything with basically no alpha
+        if(inter.a < 0.01){ discard; }
+        frag_color = inter * v_color;
+    }
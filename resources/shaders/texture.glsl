@@ -12,7 +12,10 @@
     in float i_texindex;
     // in float i_tilingfactor;
 
-    uniform mat4 viewProjection;
+    // shared by every shader, see Renderer::init_camera_buffer
+    layout(std140) uniform Camera {
+        mat4 viewProjection;
+    };
 
     out vec2 v_texcoord;
     out vec4 v_color;
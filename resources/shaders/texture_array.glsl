@@ -0,0 +1,52 @@
+
+
+////// ////// ////// ////// ////// ////// ////// //////
+//              Texture Array Shader
+////// ////// ////// ////// ////// ////// ////// ////
+
+#type vertex
+    #version 400
+    in vec3 i_pos;
+    in vec4 i_color;
+    in vec2 i_texcoord;
+    in float i_layer;
+    in float i_arrayindex;
+
+    // shared by every shader, see Renderer::init_camera_buffer
+    layout(std140) uniform Camera {
+        mat4 viewProjection;
+    };
+
+    out vec2 v_texcoord;
+    out vec4 v_color;
+    out float v_layer;
+    out float v_arrayindex;
+
+    void main(){
+        gl_Position = viewProjection * vec4(i_pos, 1.0);
+        v_texcoord = i_texcoord;
+        v_color = i_color;
+        v_layer = i_layer;
+        v_arrayindex = i_arrayindex;
+    }
+
+#type fragment
+    #version 400
+    in vec3 position;
+    in vec4 v_color;
+    in vec2 v_texcoord;
+    in float v_layer;
+    in float v_arrayindex;
+
+    uniform sampler2DArray u_arrays[4]; // check MAX_ARRAY_TEX
+
+    out vec4 frag_color;
+    void main(){
+        // Debug texcoord
+        // frag_color = vec4(v_texcoord, 0.0, 1.0) * v_color;
+        
+        vec4 inter = texture(u_arrays[int(v_arrayindex)], vec3(v_texcoord, v_layer));
+        // hide anything with basically no alpha
+        if(inter.a < 0.01){ discard; }
+        frag_color = inter * v_color;
+    }
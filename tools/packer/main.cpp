@@ -0,0 +1,25 @@
+#include "../../engine/pch.hpp"
+//
+#include "../../engine/assetpack.h"
+
+////////////////////////////////////////
+//
+// packs the resources folder into resources/assets.pack
+//
+//      packer [resources folder] [output]
+//
+// run it from the repo root after changing anything in resources/,
+// see AssetPack for the format
+//
+////////////////////////////////////////
+
+int main(int argc, char** argv) {
+    const std::string folder = argc > 1 ? argv[1] : "./resources";
+    const std::string out =
+        argc > 2 ? argv[2] : fmt::format("{}/{}", folder, AssetPack::FILENAME);
+
+    // keybindings get written back at runtime and the shader cache is
+    // per machine, both have to stay real files
+    const std::vector<std::string> skip = {"keybindings.ini", "shader_cache/"};
+    return AssetPack::build(folder, out, skip) ? 0 : 1;
+}